@@ -0,0 +1,214 @@
+// SPDX-License-Identifier: MIT
+// Decoder of MQTT traffic captured on the device into the text capture
+// format of ingest_replay.
+//
+// Input is either a binary dump or a console log with the output of the
+// "capture dump" command; the last dump in the log is decoded.
+
+extern "C" {
+#include "capture.h"
+}
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+bool read_file(const char* path, std::vector<uint8_t>& data)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+    uint8_t buffer[4096];
+    size_t size;
+    while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        data.insert(data.end(), buffer, buffer + size);
+    }
+    fclose(file);
+    return true;
+}
+
+int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/**
+ * Collect the hex lines of the last dump in a console log.
+ */
+std::vector<uint8_t> from_log(const std::vector<uint8_t>& log)
+{
+    const size_t prefix_len = strlen(CAPTURE_DUMP_PREFIX);
+    std::vector<uint8_t> dump;
+    size_t start = 0;
+
+    while (start < log.size()) {
+        size_t end = start;
+        while (end < log.size() && log[end] != '\n') {
+            ++end;
+        }
+        const char* line = reinterpret_cast<const char*>(&log[start]);
+        // the prefix may follow other output on the same line
+        const std::string text(line, end - start);
+        const size_t at = text.find(CAPTURE_DUMP_PREFIX);
+        if (at != std::string::npos) {
+            std::vector<uint8_t> bytes;
+            for (size_t i = at + prefix_len; i + 1 < text.size(); i += 2) {
+                const int high = hex_digit(text[i]);
+                const int low = hex_digit(text[i + 1]);
+                if (high < 0 || low < 0) {
+                    break;
+                }
+                bytes.push_back(static_cast<uint8_t>(high << 4 | low));
+            }
+            if (bytes.size() >= CAPTURE_MAGIC_LEN &&
+                !memcmp(bytes.data(), CAPTURE_MAGIC, CAPTURE_MAGIC_LEN)) {
+                dump.clear();
+            }
+            dump.insert(dump.end(), bytes.begin(), bytes.end());
+        }
+        start = end + 1;
+    }
+    return dump;
+}
+
+bool get_varint(const std::vector<uint8_t>& data, size_t& offset,
+                uint32_t& value)
+{
+    value = 0;
+    for (unsigned shift = 0; shift < 35; shift += 7) {
+        if (offset >= data.size()) {
+            return false;
+        }
+        const uint8_t byte = data[offset++];
+        value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Write the records as "TIMESTAMP TOPIC PAYLOAD" lines.
+ * @return number of records, negative if the dump is truncated
+ */
+long decode(const std::vector<uint8_t>& dump, FILE* out)
+{
+    size_t offset = CAPTURE_MAGIC_LEN;
+    uint64_t time_base = 0;
+    uint32_t last_ms = 0;
+    long records = 0;
+
+    fprintf(out, "# Captured MQTT traffic: TIMESTAMP TOPIC PAYLOAD\n");
+    while (offset < dump.size()) {
+        uint32_t topic_len;
+        uint32_t payload_len;
+        if (offset + 4 > dump.size()) {
+            return -1;
+        }
+        const uint32_t time_ms = dump[offset] | dump[offset + 1] << 8 |
+            dump[offset + 2] << 16 | static_cast<uint32_t>(dump[offset + 3]) << 24;
+        offset += 4;
+        if (!get_varint(dump, offset, topic_len) ||
+            !get_varint(dump, offset, payload_len) ||
+            offset + topic_len + payload_len > dump.size()) {
+            return -1;
+        }
+
+        // milliseconds since boot wrap after 49 days
+        if (records && time_ms < last_ms) {
+            time_base += UINT64_C(1) << 32;
+        }
+        last_ms = time_ms;
+
+        const char* topic = reinterpret_cast<const char*>(&dump[offset]);
+        std::string payload(reinterpret_cast<const char*>(&dump[offset + topic_len]),
+                            payload_len);
+        // one record per line, line breaks are whitespace in JSON
+        for (char& c : payload) {
+            if (c == '\n' || c == '\r') {
+                c = ' ';
+            }
+        }
+        fprintf(out, "%.3f %.*s %s\n", (time_base + time_ms) / 1000.0,
+                static_cast<int>(topic_len), topic, payload.c_str());
+        offset += topic_len + payload_len;
+        ++records;
+    }
+    return records;
+}
+
+void usage(const char* app)
+{
+    printf("Usage: %s [-o OUTPUT] INPUT\n", app);
+    printf("  INPUT  binary dump or console log with \"capture dump\" "
+           "output\n");
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    const char* input = nullptr;
+    const char* output = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            output = argv[++i];
+        } else if (argv[i][0] != '-' && !input) {
+            input = argv[i];
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (!input) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::vector<uint8_t> data;
+    if (!read_file(input, data)) {
+        return EXIT_FAILURE;
+    }
+    if (data.size() < CAPTURE_MAGIC_LEN ||
+        memcmp(data.data(), CAPTURE_MAGIC, CAPTURE_MAGIC_LEN)) {
+        data = from_log(data);
+    }
+    if (data.size() < CAPTURE_MAGIC_LEN) {
+        fprintf(stderr, "%s: no capture dump found\n", input);
+        return EXIT_FAILURE;
+    }
+
+    FILE* out = output ? fopen(output, "w") : stdout;
+    if (!out) {
+        perror(output);
+        return EXIT_FAILURE;
+    }
+    const long records = decode(data, out);
+    if (output) {
+        fclose(out);
+    }
+    if (records < 0) {
+        fprintf(stderr, "%s: truncated dump\n", input);
+        return EXIT_FAILURE;
+    }
+    fprintf(stderr, "%ld records\n", records);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,315 @@
+// SPDX-License-Identifier: MIT
+// Display rendering benchmark for the host.
+
+extern "C" {
+#include "display.h"
+}
+
+#include "display_backend.h"
+#include "display_format.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// SPI clock used to estimate bus time
+#define BUS_MHZ 40
+
+namespace {
+
+// Benchmarked entry point, called with iteration number
+struct bench_case {
+    const char* name;
+    void (*run)(unsigned iter);
+};
+
+void run_static(unsigned)
+{
+    display_static_elements();
+}
+
+void run_time(unsigned iter)
+{
+    struct ntpTime time = {
+        .hours = static_cast<uint8_t>(iter / 60 % 24),
+        .minutes = static_cast<uint8_t>(iter % 60),
+        .seconds = static_cast<uint8_t>(iter * 7 % 60),
+    };
+    display_time(&time);
+}
+
+void run_price(unsigned iter)
+{
+    struct Price price = {
+        .level = static_cast<enum pricelevel>(iter % 3),
+        .euros = static_cast<float>(iter % 3000) / 100,
+    };
+    display_price(&price, 10, 230);
+}
+
+void run_avgprice(unsigned iter)
+{
+    struct Price price = {
+        .level = normal,
+        .euros = static_cast<float>(iter % 1500) / 100,
+    };
+    display_price(&price, 160, 230);
+}
+
+void run_temperature(unsigned iter)
+{
+    display_temperature(20.0f + static_cast<float>(iter % 400) / 10);
+}
+
+void run_level(unsigned iter)
+{
+    display_level(iter % 6 * 20);
+}
+
+void run_comm(unsigned iter)
+{
+    struct commState state = {
+        .wifi = (iter & 1) != 0,
+        .ntp = (iter & 2) != 0,
+        .mqtt = (iter & 4) != 0,
+    };
+    display_comm(&state);
+}
+
+void run_icon(unsigned iter)
+{
+    static const enum image_type icons[] = {
+        image_car, image_door,   image_flood,
+        image_burner, image_heater, image_solar,
+    };
+    const size_t index = iter % 6;
+    display_icon(static_cast<enum indicator>(iter / 6 % 3), icons[index],
+                 index);
+}
+
+void run_indicator(unsigned iter)
+{
+    display_indicator(static_cast<enum indicator>(iter / 6 % 3), iter % 6);
+}
+
+const bench_case cases[] = {
+    { "static_elements", run_static      },
+    { "time",            run_time        },
+    { "price",           run_price       },
+    { "avgprice",        run_avgprice    },
+    { "temperature",     run_temperature },
+    { "level",           run_level       },
+    { "comm",            run_comm        },
+    { "icon",            run_icon        },
+    { "indicator",       run_indicator   },
+};
+
+/**
+ * Get FNV-1a hash of the framebuffer, used to compare rendering output.
+ */
+uint32_t framebuffer_hash(void)
+{
+    const uint32_t* fb = display_framebuffer();
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < DISPLAY_WIDTH * DISPLAY_HEIGHT; ++i) {
+        for (size_t b = 0; b < 4; ++b) {
+            hash ^= (fb[i] >> (b * 8)) & 0xff;
+            hash *= 16777619u;
+        }
+    }
+    return hash;
+}
+
+/**
+ * Repeat the benchmarked calls without timing, starting on a cleared screen.
+ * @param iterations calls per entry point
+ * @param full_redraw forget retained screen content before each call
+ * @param compose compose mode
+ * @return framebuffer hash
+ */
+uint32_t replay(unsigned iterations, bool full_redraw, bool compose)
+{
+    display_init();
+    display_indicatoramount(6);
+    display_set_compose(compose);
+    for (const bench_case& bc : cases) {
+        for (unsigned iter = 0; iter < iterations; ++iter) {
+            if (full_redraw) {
+                display_invalidate();
+            }
+            bc.run(iter);
+            display_flush();
+        }
+    }
+    for (unsigned iter = 0; iter < iterations; ++iter) {
+        display_invalidate();
+        for (const bench_case& bc : cases) {
+            bc.run(iter);
+        }
+        display_flush();
+    }
+    return framebuffer_hash();
+}
+
+/**
+ * Write framebuffer as binary PPM image.
+ */
+bool write_ppm(const char* path)
+{
+    FILE* out = fopen(path, "wb");
+    if (!out) {
+        return false;
+    }
+    const uint32_t* fb = display_framebuffer();
+    fprintf(out, "P6\n%d %d\n255\n", DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    for (size_t i = 0; i < DISPLAY_WIDTH * DISPLAY_HEIGHT; ++i) {
+        const uint8_t rgb[] = {
+            static_cast<uint8_t>(fb[i] >> 16),
+            static_cast<uint8_t>(fb[i] >> 8),
+            static_cast<uint8_t>(fb[i]),
+        };
+        fwrite(rgb, 1, sizeof(rgb), out);
+    }
+    return fclose(out) == 0;
+}
+
+void usage(const char* app)
+{
+    printf("Usage: %s [-n ITERATIONS] [-b fb|null] [-f] [-c] [-d] [-v] "
+           "[-o IMAGE.ppm]\n"
+           "  -f  full redraw, forget retained screen content before each call\n"
+           "  -c  compose mode, flush after each call and each frame\n"
+           "  -d  simulate DMA transfers of the framebuffer at %u MHz\n"
+           "  -v  verify, replay in the other mode and fail if the framebuffer "
+           "differs\n",
+           app, BUS_MHZ);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    unsigned iterations = 1000;
+    bool null_sink = false;
+    bool full_redraw = false;
+    bool compose = false;
+    bool dma = false;
+    bool verify = false;
+    const char* ppm = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            iterations = strtoul(argv[++i], nullptr, 0);
+        } else if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+            null_sink = !strcmp(argv[++i], "null");
+        } else if (!strcmp(argv[i], "-f")) {
+            full_redraw = true;
+        } else if (!strcmp(argv[i], "-c")) {
+            compose = true;
+        } else if (!strcmp(argv[i], "-d")) {
+            dma = true;
+        } else if (!strcmp(argv[i], "-v")) {
+            verify = true;
+        } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            ppm = argv[++i];
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    display_set_backend(null_sink ? display_null_backend()
+                                  : display_framebuffer_backend());
+    display_init();
+    if (dma) {
+        display_framebuffer_dma(BUS_MHZ * 1000000);
+    }
+    display_indicatoramount(6);
+    display_set_compose(compose);
+
+    printf("backend: %s, format: %s, mode: %s, iterations: %u\n",
+           null_sink ? "null" : "framebuffer", display_format::name,
+           compose ? "compose" : "direct", iterations);
+    printf("%-16s %10s %10s %12s %12s %10s %8s %8s\n", "entry", "us/call",
+           "pixels", "bus bytes", "windows", "Mpix/s", "cache %", "skip %");
+
+    for (const bench_case& bc : cases) {
+        struct display_stats st;
+        display_reset_stats();
+        const auto start = std::chrono::steady_clock::now();
+        for (unsigned iter = 0; iter < iterations; ++iter) {
+            if (full_redraw) {
+                display_invalidate();
+            }
+            bc.run(iter);
+            display_flush();
+        }
+        const auto end = std::chrono::steady_clock::now();
+        display_get_stats(&st);
+
+        const double us =
+            std::chrono::duration<double, std::micro>(end - start).count();
+        const double calls = iterations ? iterations : 1;
+        const uint32_t lookups = st.cache_hits + st.cache_misses;
+        const uint32_t draws = st.draws_performed + st.draws_skipped;
+        printf("%-16s %10.2f %10.0f %12.0f %12.0f %10.2f %8.1f %8.1f\n",
+               bc.name, us / calls, st.pixels / calls, st.bus_bytes / calls,
+               st.windows / calls, us > 0 ? st.pixels / us : 0.0,
+               lookups ? 100.0 * st.cache_hits / lookups : 0.0,
+               draws ? 100.0 * st.draws_skipped / draws : 0.0);
+    }
+
+    // full frame: every entry point drawn on an invalidated screen
+    struct display_stats st;
+    uint64_t render_us = 0, bus_us = 0, wait_us = 0, frame_us = 0;
+    display_reset_stats();
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned iter = 0; iter < iterations; ++iter) {
+        display_invalidate();
+        for (const bench_case& bc : cases) {
+            bc.run(iter);
+        }
+        display_flush();
+        display_get_stats(&st);
+        frame_us += st.frame_us;
+        render_us += st.render_us;
+        bus_us += st.bus_us;
+        wait_us += st.wait_us;
+    }
+    const auto end = std::chrono::steady_clock::now();
+    display_get_stats(&st);
+
+    const double frames = iterations ? iterations : 1;
+    const double frame_bytes = st.bus_bytes / frames;
+    printf("frame: %.2f us cpu, %.0f bus bytes, %.2f ms bus at %u MHz\n",
+           std::chrono::duration<double, std::micro>(end - start).count() /
+               frames,
+           frame_bytes, frame_bytes * 8 / BUS_MHZ / 1000, BUS_MHZ);
+    if (compose) {
+        printf("flush: %.2f us, render %.2f us, bus %.2f us, cpu waiting "
+               "%.2f us\n",
+               frame_us / frames, render_us / frames, bus_us / frames,
+               wait_us / frames);
+    }
+    printf("glyph cache: %u bytes\n", st.cache_bytes);
+
+    if (!null_sink) {
+        const uint32_t hash = framebuffer_hash();
+        printf("framebuffer hash: %08x\n", hash);
+        if (ppm && !write_ppm(ppm)) {
+            fprintf(stderr, "Unable to write %s\n", ppm);
+            return EXIT_FAILURE;
+        }
+        if (verify) {
+            const uint32_t other = replay(iterations, full_redraw, !compose);
+            printf("%s hash: %08x\n", compose ? "direct" : "compose", other);
+            if (other != hash) {
+                fprintf(stderr, "Compose and direct mode output differ\n");
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
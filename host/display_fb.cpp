@@ -0,0 +1,232 @@
+// SPDX-License-Identifier: MIT
+// Host display backends: in-memory framebuffer and null sink.
+
+extern "C" {
+#include "display.h"
+}
+
+#include "display_backend.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+class framebuffer_backend : public display_backend {
+public:
+    ~framebuffer_backend() override
+    {
+        if (worker.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stop = true;
+            }
+            cond.notify_all();
+            worker.join();
+        }
+    }
+
+    void init(enum pixel_format_id fmt) override
+    {
+        wait();
+        format = fmt;
+        std::fill(std::begin(pixels), std::end(pixels), 0);
+    }
+
+    void start_write() override {}
+
+    void end_write() override {}
+
+    void set_window(size_t x, size_t y, size_t width, size_t height) override
+    {
+        wait();
+        win_x = x;
+        win_y = y;
+        win_width = width;
+        win_height = height;
+        cur_x = 0;
+        cur_y = 0;
+    }
+
+    void write_color(uint32_t color, size_t length) override
+    {
+        while (length-- && cur_y < win_height) {
+            put(win_x + cur_x, win_y + cur_y, color);
+            if (++cur_x == win_width) {
+                cur_x = 0;
+                ++cur_y;
+            }
+        }
+    }
+
+    // decoded from the bus order like the panel does, pixels in native
+    // order show up as wrong colors and change the framebuffer hash
+    void push_pixels(const void* data, size_t length) override
+    {
+        if (format == PIXEL_RGB565) {
+            const uint16_t* src = static_cast<const uint16_t*>(data);
+            for (size_t i = 0; i < length; ++i) {
+                write_color(rgb565::from_bus(src[i]), 1);
+            }
+        } else {
+            const uint32_t* src = static_cast<const uint32_t*>(data);
+            for (size_t i = 0; i < length; ++i) {
+                write_color(rgb888::from_bus(src[i]), 1);
+            }
+        }
+    }
+
+    void push_pixels_async(const void* data, size_t length) override
+    {
+        if (!bus_hz) {
+            const auto start = std::chrono::steady_clock::now();
+            push_pixels(data, length);
+            bus_time += std::chrono::steady_clock::now() - start;
+            return;
+        }
+        wait();
+        std::lock_guard<std::mutex> lock(mutex);
+        job_data = data;
+        job_length = length;
+        cond.notify_all();
+    }
+
+    void wait() override
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [this] { return !job_data; });
+    }
+
+    void fill_rect(size_t x, size_t y, size_t width, size_t height,
+                   uint32_t color) override
+    {
+        set_window(x, y, width, height);
+        write_color(color, width * height);
+    }
+
+    uint64_t bus_time_us() const override
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(bus_time)
+            .count();
+    }
+
+    void simulate_dma(uint32_t hz)
+    {
+        wait();
+        bus_hz = hz;
+        if (hz && !worker.joinable()) {
+            worker = std::thread(&framebuffer_backend::transfer, this);
+        }
+    }
+
+    uint32_t pixels[DISPLAY_WIDTH * DISPLAY_HEIGHT];
+
+private:
+    void put(size_t x, size_t y, uint32_t color)
+    {
+        if (x < DISPLAY_WIDTH && y < DISPLAY_HEIGHT) {
+            pixels[y * DISPLAY_WIDTH + x] = format == PIXEL_RGB565
+                ? rgb565::to_rgb888(color)
+                : rgb888::to_rgb888(color);
+        }
+    }
+
+    /**
+     * DMA worker: writes pushed pixels and holds the bus for the time the
+     * transfer takes at bus_hz.
+     */
+    void transfer()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            cond.wait(lock, [this] { return job_data || stop; });
+            if (stop) {
+                return;
+            }
+            const auto start = std::chrono::steady_clock::now();
+            const size_t bytes =
+                job_length * (format == PIXEL_RGB565 ? 2 : 3);
+            const auto duration = std::chrono::nanoseconds(
+                static_cast<uint64_t>(bytes) * 8 * 1000000000 / bus_hz);
+            lock.unlock();
+            push_pixels(job_data, job_length);
+            while (std::chrono::steady_clock::now() - start < duration) {
+            }
+            lock.lock();
+            bus_time += std::chrono::steady_clock::now() - start;
+            job_data = nullptr;
+            cond.notify_all();
+        }
+    }
+
+    enum pixel_format_id format = PIXEL_RGB565;
+    // simulated DMA
+    uint32_t bus_hz = 0;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable cond;
+    const void* job_data = nullptr;
+    size_t job_length = 0;
+    bool stop = false;
+    std::chrono::steady_clock::duration bus_time {};
+    // current address window and write position inside it
+    size_t win_x, win_y, win_width, win_height;
+    size_t cur_x, cur_y;
+};
+
+class null_backend : public display_backend {
+public:
+    void init(enum pixel_format_id) override {}
+
+    void start_write() override {}
+
+    void end_write() override {}
+
+    void set_window(size_t, size_t, size_t, size_t) override {}
+
+    void write_color(uint32_t, size_t) override {}
+
+    void push_pixels(const void*, size_t) override {}
+
+    void fill_rect(size_t, size_t, size_t, size_t, uint32_t) override {}
+};
+
+framebuffer_backend framebuffer;
+null_backend null_sink;
+
+} // namespace
+
+uint64_t display_now_us(void)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+display_backend* display_default_backend(void)
+{
+    return &framebuffer;
+}
+
+display_backend* display_framebuffer_backend(void)
+{
+    return &framebuffer;
+}
+
+display_backend* display_null_backend(void)
+{
+    return &null_sink;
+}
+
+void display_framebuffer_dma(uint32_t bus_hz)
+{
+    framebuffer.simulate_dma(bus_hz);
+}
+
+const uint32_t* display_framebuffer(void)
+{
+    return framebuffer.pixels;
+}
@@ -0,0 +1,17 @@
+// SPDX-License-Identifier: MIT
+// ESP-IDF logging for the host build: errors and warnings to stderr, other
+// levels compiled out so they do not disturb the measurements.
+
+#pragma once
+
+#include <stdio.h>
+
+#define ESP_LOG_HOST(letter, tag, format, ...) \
+    fprintf(stderr, letter " (%s): " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOG_NONE(tag, format, ...) ((void)(tag))
+
+#define ESP_LOGE(tag, format, ...) ESP_LOG_HOST("E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) ESP_LOG_HOST("W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) ESP_LOG_NONE(tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) ESP_LOG_NONE(tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) ESP_LOG_NONE(tag, format, ##__VA_ARGS__)
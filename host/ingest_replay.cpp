@@ -0,0 +1,316 @@
+// SPDX-License-Identifier: MIT
+// Replay of recorded MQTT traffic through the ingestion path on the host.
+//
+// Capture file: one message per line, "TIMESTAMP TOPIC PAYLOAD", timestamp
+// in seconds, payload up to the end of the line. Empty lines and lines
+// starting with '#' are skipped.
+
+extern "C" {
+#include "ingest.h"
+#include "json_arena.h"
+#include "reassembly.h"
+#include "trace.h"
+}
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Heap allocations of the ingestion code, the executable is linked with
+// --wrap so calls from the ingestion objects land here
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+size_t allocs;
+size_t alloc_bytes;
+
+void* __wrap_malloc(size_t size)
+{
+    ++allocs;
+    alloc_bytes += size;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size)
+{
+    ++allocs;
+    alloc_bytes += count * size;
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size)
+{
+    ++allocs;
+    alloc_bytes += size;
+    return __real_realloc(ptr, size);
+}
+}
+
+namespace {
+
+struct record {
+    double time;
+    std::string topic;
+    std::string payload;
+    int route;
+};
+
+/**
+ * Render queue stand-in: the render task empties the queue once per frame,
+ * measurements posted to a full queue are dropped.
+ */
+struct stub_queue {
+    size_t size = 15;    // evt_queue length
+    double frame = 0.04; // frame period, s
+    size_t used = 0;
+    double frame_end = 0;
+    uint64_t queued = 0;
+    uint64_t dropped = 0;
+    size_t high_water = 0;
+
+    // Advance capture time, frames passed drain the queue
+    void advance(double time)
+    {
+        if (time >= frame_end) {
+            used = 0;
+            frame_end = time + frame;
+        }
+    }
+
+    void post()
+    {
+        if (used == size) {
+            ++dropped;
+            return;
+        }
+        ++queued;
+        if (++used > high_water) {
+            high_water = used;
+        }
+    }
+};
+
+stub_queue queue;
+
+int64_t now_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void post_meas(struct measurement* meas)
+{
+    meas->queued_us = now_us();
+    trace_record(meas);
+    queue.post();
+}
+
+bool load(const char* path, std::vector<record>& records)
+{
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+
+    char* line = nullptr;
+    size_t capacity = 0;
+    ssize_t length;
+    unsigned number = 0;
+    while ((length = getline(&line, &capacity, file)) >= 0) {
+        ++number;
+        while (length && (line[length - 1] == '\n' || line[length - 1] == '\r')) {
+            line[--length] = 0;
+        }
+        if (!length || line[0] == '#') {
+            continue;
+        }
+        char* end;
+        const double time = strtod(line, &end);
+        char* topic = end + strspn(end, " \t");
+        const size_t topic_len = strcspn(topic, " \t");
+        if (end == line || !topic_len || !topic[topic_len]) {
+            fprintf(stderr, "%s:%u: invalid record\n", path, number);
+            continue;
+        }
+        const char* payload = topic + topic_len + 1;
+        records.push_back({ time, std::string(topic, topic_len), payload,
+                            -1 });
+    }
+    free(line);
+    fclose(file);
+    return true;
+}
+
+/**
+ * Feed payload in data events of at most buffer bytes, like esp-mqtt does
+ * with payloads larger than its input buffer.
+ */
+void feed(const record& r, std::vector<char>& scratch, size_t buffer)
+{
+    const size_t total = r.payload.size();
+    memcpy(scratch.data(), r.payload.data(), total);
+
+    size_t offset = 0;
+    do {
+        const size_t length = std::min(buffer, total - offset);
+        const struct mqtt_fragment frag = {
+            .topic = offset ? nullptr : r.topic.data(),
+            .topic_len = offset ? 0 : r.topic.size(),
+            .msg_id = 0,
+            .data = scratch.data() + offset,
+            .length = length,
+            .offset = offset,
+            .total = total,
+            .time_us = now_us(),
+        };
+        ingest_fragment(&frag);
+        offset += length;
+    } while (offset < total);
+}
+
+void usage(const char* app)
+{
+    printf("Usage: %s [-n PASSES] [-b BUFFER] [-q QUEUE] [-f FPS] CAPTURE\n",
+           app);
+    printf("  -n  passes over the capture, each from a fresh state (1)\n");
+    printf("  -b  MQTT input buffer size, larger payloads are fragmented "
+           "(1024)\n");
+    printf("  -q  render queue length (15)\n");
+    printf("  -f  frame rate draining the queue, in capture time (25)\n");
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    unsigned passes = 1;
+    size_t buffer = 1024;
+    double fps = 25;
+    const char* path = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            passes = strtoul(argv[++i], nullptr, 0);
+        } else if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+            buffer = strtoul(argv[++i], nullptr, 0);
+        } else if (!strcmp(argv[i], "-q") && i + 1 < argc) {
+            queue.size = strtoul(argv[++i], nullptr, 0);
+        } else if (!strcmp(argv[i], "-f") && i + 1 < argc) {
+            fps = strtod(argv[++i], nullptr);
+        } else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (!path || !buffer || !passes || fps <= 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    queue.frame = 1 / fps;
+
+    std::vector<record> records;
+    if (!load(path, records) || records.empty()) {
+        fprintf(stderr, "%s: no records\n", path);
+        return EXIT_FAILURE;
+    }
+    if (!ingest_init(post_meas, now_us)) {
+        return EXIT_FAILURE;
+    }
+
+    // per-route time, the last slot is for unrouted topics
+    size_t num_routes = 0;
+    while (ingest_route_topic(num_routes)) {
+        ++num_routes;
+    }
+    std::vector<double> route_ns(num_routes + 1);
+    std::vector<uint64_t> route_msgs(num_routes + 1);
+    size_t largest = 0;
+    for (record& r : records) {
+        r.route = ingest_route(r.topic.data(), r.topic.size());
+        if (r.route < 0) {
+            r.route = num_routes;
+        }
+        largest = std::max(largest, r.payload.size());
+    }
+    std::vector<char> scratch(largest + 1);
+
+    allocs = 0;
+    alloc_bytes = 0;
+    double total_ns = 0;
+
+    for (unsigned pass = 0; pass < passes; ++pass) {
+        ingest_init(post_meas, now_us);
+        queue.frame_end = 0;
+        queue.used = 0;
+        for (const record& r : records) {
+            queue.advance(r.time);
+            const auto start = std::chrono::steady_clock::now();
+            feed(r, scratch, buffer);
+            const auto end = std::chrono::steady_clock::now();
+            const double ns =
+                std::chrono::duration<double, std::nano>(end - start).count();
+            route_ns[r.route] += ns;
+            ++route_msgs[r.route];
+            total_ns += ns;
+        }
+    }
+
+    struct ingest_stats stats;
+    ingest_stats(&stats);
+    const double msgs = static_cast<double>(records.size()) * passes;
+    const double span = records.back().time - records.front().time;
+
+    printf("capture: %zu messages, %.1f s, passes: %u\n", records.size(),
+           span, passes);
+    printf("%-48s %10s %10s\n", "route", "msgs", "ns/msg");
+    for (size_t r = 0; r <= num_routes; ++r) {
+        if (!route_msgs[r]) {
+            continue;
+        }
+        printf("%-48s %10llu %10.1f\n",
+               r < num_routes ? ingest_route_topic(r) : "(not routed)",
+               static_cast<unsigned long long>(route_msgs[r]),
+               route_ns[r] / route_msgs[r]);
+    }
+    printf("total: %.0f msg/s, %.1f ns/msg, %.2f allocs/msg, "
+           "%.1f alloc B/msg\n",
+           total_ns > 0 ? msgs * 1e9 / total_ns : 0.0, total_ns / msgs,
+           allocs / msgs, alloc_bytes / msgs);
+    printf("ingest: %lu received, %lu ignored, %lu identical, %lu parsed, "
+           "%lu unchanged, %lu routed, %lu measurements\n",
+           static_cast<unsigned long>(stats.received),
+           static_cast<unsigned long>(stats.ignored),
+           static_cast<unsigned long>(stats.duplicates),
+           static_cast<unsigned long>(stats.parsed),
+           static_cast<unsigned long>(stats.unchanged),
+           static_cast<unsigned long>(stats.routed),
+           static_cast<unsigned long>(stats.emitted));
+    printf("queue: %llu queued, %llu dropped, %zu of %zu high water "
+           "at %.0f fps\n",
+           static_cast<unsigned long long>(queue.queued),
+           static_cast<unsigned long long>(queue.dropped), queue.high_water,
+           queue.size, fps);
+
+    struct reassembly_stats reasm;
+    reassembly_stats(&reasm);
+    printf("fragmented: %lu, %lu completed, %lu dropped, %lu oversize, "
+           "%lu long topic\n",
+           static_cast<unsigned long>(reasm.fragmented),
+           static_cast<unsigned long>(reasm.completed),
+           static_cast<unsigned long>(reasm.dropped),
+           static_cast<unsigned long>(reasm.oversize),
+           static_cast<unsigned long>(reasm.long_topic));
+    trace_print();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,298 @@
+// SPDX-License-Identifier: MIT
+// JSON field extraction benchmark for the host: cJSON tree vs streaming.
+
+extern "C" {
+#include "cJSON.h"
+#include "json_arena.h"
+#include "json_extract.h"
+}
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+// Keys read by handleJson
+const char* const keys[] = {
+    "id",         "value", "sensor",  "state", "contact", "device",
+    "water_leak", "power", "pricestate", "price", "weekday", "avg",
+};
+constexpr size_t num_keys = sizeof(keys) / sizeof(keys[0]);
+
+// Recorded payloads
+struct payload {
+    const char* topic;
+    const char* data;
+};
+
+const payload payloads[] = {
+    { "home/kallio/thermostat/0/parameters/level",
+      R"({"id":"thermostat","value":3})" },
+    { "home/kallio/thermostat/0/parameters/temperature",
+      R"({"id":"temperature","sensor":"ntc","value":47.25})" },
+    { "home/kallio/relay/0/shellyplus1pm/state",
+      R"({"id":"relay","device":"shellyplus1pm","contact":0,"state":true,)"
+      R"("power":1512.4,"voltage":231.2,"current":6.54})" },
+    { "home/kallio/relay/2/shelly1/state",
+      R"({"id":"relay","device":"shelly1","contact":2,"state":false})" },
+    { "home/kallio/elprice/currentquart",
+      R"({"id":"elprice","price":12.87,"pricestate":"high",)"
+      R"("start":"2024-11-20T18:00:00","end":"2024-11-20T18:15:00"})" },
+    { "home/kallio/elprice/daystats/3",
+      R"({"id":"daystats","weekday":3,"avg":8.42,"min":2.11,"max":19.75})" },
+    { "zigbee2mqtt/front_door",
+      R"({"battery":100,"contact":true,"device_temperature":21,)"
+      R"("linkquality":116,"power_outage_count":12,"voltage":3005})" },
+    { "zigbee2mqtt/boiler_door",
+      R"({"battery":91,"contact":false,"device_temperature":27,)"
+      R"("linkquality":72,"power_outage_count":4,"update":{)"
+      R"("installed_version":-1,"latest_version":-1,"state":null},)"
+      R"("update_available":null,"voltage":2985})" },
+    { "zigbee2mqtt/lattia",
+      R"({"battery":97,"battery_low":false,"device_temperature":19,)"
+      R"("linkquality":65,"power_outage_count":3,"tamper":false,)"
+      R"("voltage":2995,"water_leak":false})" },
+    { "zigbee2mqtt/living_room_plug",
+      R"({"current":0.12,"energy":143.87,"linkquality":156,"power":18,)"
+      R"("power_on_behavior":"previous","state":"ON","update":{)"
+      R"("installed_version":587765297,"latest_version":587765297,)"
+      R"("state":"idle"},"voltage":232})" },
+    { "zigbee2mqtt/bridge/state", R"({"state":"online"})" },
+    { "zigbee2mqtt/bridge/logging",
+      R"({"level":"info","message":"MQTT publish: topic )"
+      R"('zigbee2mqtt/lattia', payload '{\"battery\":97}'"})" },
+};
+constexpr size_t num_payloads = sizeof(payloads) / sizeof(payloads[0]);
+
+// System heap allocation counters
+size_t allocs;
+size_t alloc_bytes;
+
+void* count_malloc(size_t size)
+{
+    ++allocs;
+    alloc_bytes += size;
+    return malloc(size);
+}
+
+void count_free(void* ptr)
+{
+    free(ptr);
+}
+
+// Prevents the compiler from dropping the extracted values
+volatile double sink;
+
+void consume(const json_value* values)
+{
+    double sum = 0;
+    for (size_t i = 0; i < num_keys; ++i) {
+        sum += values[i].type == JSON_NUMBER
+            ? values[i].number
+            : static_cast<double>(values[i].type);
+    }
+    sink = sum;
+}
+
+// Current path: parse the whole tree, then look up the keys
+void run_cjson(const payload& p, size_t)
+{
+    json_value values[num_keys];
+    cJSON* root = cJSON_Parse(p.data);
+    if (root) {
+        json_extract_tree(root, keys, values, num_keys);
+        consume(values);
+        cJSON_Delete(root);
+    }
+}
+
+// Current path with the per-message arena
+void run_cjson_arena(const payload& p, size_t length)
+{
+    run_cjson(p, length);
+    json_arena_reset();
+}
+
+// Per-message arena and strings kept in the payload, the payload is copied
+// as the event buffer is reused on the device
+void run_cjson_insitu(const payload& p, size_t length)
+{
+    static char buffer[1024];
+    json_value values[num_keys];
+    memcpy(buffer, p.data, length);
+    cJSON* root = cJSON_ParseInSitu(buffer, length);
+    if (root) {
+        json_extract_tree(root, keys, values, num_keys);
+        consume(values);
+        cJSON_DeleteInSitu(root);
+    }
+    json_arena_reset();
+}
+
+// Streaming extractor with cJSON fallback for escaped strings
+void run_extract(const payload& p, size_t length)
+{
+    json_value values[num_keys];
+    switch (json_extract(p.data, length, keys, values, num_keys)) {
+        case JSON_EXTRACT_OK:
+            consume(values);
+            break;
+        case JSON_EXTRACT_FALLBACK:
+            run_cjson(p, length);
+            break;
+        case JSON_EXTRACT_INVALID:
+            break;
+    }
+}
+
+// cJSON allocator that counts heap allocations
+void use_heap(void)
+{
+    cJSON_Hooks hooks = { count_malloc, count_free };
+    cJSON_InitHooks(&hooks);
+}
+
+// Arena allocator, heap allocations are counted by the arena
+void use_arena(void)
+{
+    json_arena_init();
+}
+
+struct bench_case {
+    const char* name;
+    void (*setup)(void);
+    void (*run)(const payload& p, size_t length);
+};
+
+const bench_case cases[] = {
+    { "cjson",       use_heap,  run_cjson        },
+    { "cjson_arena", use_arena, run_cjson_arena  },
+    { "cjson_insitu", use_arena, run_cjson_insitu },
+    { "extract",     use_heap,  run_extract      },
+};
+
+/**
+ * Compare values extracted by two paths.
+ */
+bool same_values(const json_value* a, const json_value* b, const payload& p,
+                 const char* path)
+{
+    bool ok = true;
+    for (size_t i = 0; i < num_keys; ++i) {
+        const bool same = a[i].type == b[i].type &&
+            (a[i].type != JSON_NUMBER || a[i].number == b[i].number) &&
+            (a[i].type != JSON_STRING ||
+             (a[i].length == b[i].length &&
+              !memcmp(a[i].string, b[i].string, a[i].length)));
+        if (!same) {
+            fprintf(stderr, "%s: %s key %s differs\n", p.topic, path, keys[i]);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+/**
+ * Check that all paths extract the same values.
+ */
+bool verify(void)
+{
+    bool ok = true;
+    for (const payload& p : payloads) {
+        json_value tree[num_keys];
+        json_value other[num_keys];
+        cJSON* root = cJSON_Parse(p.data);
+        if (!root) {
+            continue;
+        }
+        json_extract_tree(root, keys, tree, num_keys);
+
+        if (json_extract(p.data, strlen(p.data), keys, other, num_keys) ==
+            JSON_EXTRACT_OK) {
+            ok &= same_values(tree, other, p, "extract");
+        }
+
+        char buffer[1024];
+        strcpy(buffer, p.data);
+        cJSON* insitu = cJSON_ParseInSitu(buffer, strlen(buffer));
+        if (insitu) {
+            json_extract_tree(insitu, keys, other, num_keys);
+            ok &= same_values(tree, other, p, "in situ");
+            cJSON_DeleteInSitu(insitu);
+        } else {
+            fprintf(stderr, "%s: in situ parse failed\n", p.topic);
+            ok = false;
+        }
+
+        cJSON_Delete(root);
+    }
+    return ok;
+}
+
+void usage(const char* app)
+{
+    printf("Usage: %s [-n ITERATIONS]\n", app);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    unsigned iterations = 100000;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            iterations = strtoul(argv[++i], nullptr, 0);
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!verify()) {
+        return EXIT_FAILURE;
+    }
+
+    size_t lengths[num_payloads];
+    for (size_t i = 0; i < num_payloads; ++i) {
+        lengths[i] = strlen(payloads[i].data);
+    }
+
+    printf("payloads: %zu, iterations: %u\n", num_payloads, iterations);
+    printf("%-13s %12s %10s %12s %14s\n", "path", "msg/s", "ns/msg",
+           "allocs/msg", "alloc B/msg");
+
+    for (const bench_case& bc : cases) {
+        struct json_arena_stats arena_before, arena_after;
+        bc.setup();
+        json_arena_stats(&arena_before);
+        allocs = 0;
+        alloc_bytes = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (unsigned iter = 0; iter < iterations; ++iter) {
+            for (size_t i = 0; i < num_payloads; ++i) {
+                bc.run(payloads[i], lengths[i]);
+            }
+        }
+        const auto end = std::chrono::steady_clock::now();
+        json_arena_stats(&arena_after);
+        allocs += arena_after.heap_allocs - arena_before.heap_allocs;
+
+        const double ns =
+            std::chrono::duration<double, std::nano>(end - start).count();
+        const double msgs =
+            static_cast<double>(iterations ? iterations : 1) * num_payloads;
+        printf("%-13s %12.0f %10.1f %12.2f %14.1f\n", bc.name,
+               ns > 0 ? msgs * 1e9 / ns : 0.0, ns / msgs, allocs / msgs,
+               alloc_bytes / msgs);
+    }
+
+    struct json_arena_stats arena;
+    json_arena_stats(&arena);
+    printf("arena high water: %zu of %u bytes\n", arena.high_water,
+           JSON_ARENA_SIZE);
+
+    return EXIT_SUCCESS;
+}
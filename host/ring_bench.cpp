@@ -0,0 +1,263 @@
+// SPDX-License-Identifier: MIT
+// SPSC measurement ring on the host: two thread stress test, throughput
+// and latency against a locked queue with FreeRTOS queue semantics.
+
+extern "C" {
+#include "spsc_ring.h"
+}
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <semaphore>
+#include <thread>
+#include <vector>
+
+namespace {
+
+int64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+/**
+ * SPSC ring with the wakeup protocol of the render task: the consumer
+ * sleeps when all entries are taken, the producer wakes it when asked.
+ */
+struct ring_channel {
+    spsc_ring ring;
+    std::binary_semaphore wakeup{ 0 };
+
+    ring_channel()
+    {
+        spsc_ring_init(&ring);
+    }
+
+    bool send(const measurement& meas)
+    {
+        bool wake;
+        if (!spsc_ring_push(&ring, &meas, &wake)) {
+            return false;
+        }
+        if (wake) {
+            wakeup.release();
+        }
+        return true;
+    }
+
+    void receive(measurement& meas)
+    {
+        while (!spsc_ring_pop(&ring, &meas)) {
+            if (spsc_ring_idle(&ring)) {
+                wakeup.acquire();
+            }
+        }
+    }
+};
+
+/**
+ * FreeRTOS queue model: every send and receive copies the item inside a
+ * critical section, receive blocks on an empty queue.
+ */
+struct queue_channel {
+    std::mutex lock;
+    std::condition_variable not_empty;
+    measurement items[SPSC_RING_SIZE];
+    size_t head = 0;
+    size_t count = 0;
+
+    bool send(const measurement& meas)
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        if (count == SPSC_RING_SIZE) {
+            return false;
+        }
+        items[(head + count++) % SPSC_RING_SIZE] = meas;
+        guard.unlock();
+        not_empty.notify_one();
+        return true;
+    }
+
+    void receive(measurement& meas)
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        not_empty.wait(guard, [this] { return count > 0; });
+        meas = items[head];
+        head = (head + 1) % SPSC_RING_SIZE;
+        --count;
+    }
+};
+
+struct result {
+    double msgs_per_s;
+    std::vector<int64_t> latency; // ns, sorted
+    uint64_t full;                // sends retried on a full channel
+    bool ordered;
+};
+
+/**
+ * Send count measurements from one thread to another.
+ * @param gap_ns producer pause between sends, 0 for back-to-back
+ */
+template <typename Channel>
+result run(unsigned count, int64_t gap_ns)
+{
+    auto channel = std::make_unique<Channel>();
+    result res = { 0, {}, 0, true };
+    res.latency.resize(count);
+
+    const int64_t start = now_ns();
+    std::thread consumer([&] {
+        measurement meas;
+        for (unsigned i = 0; i < count; ++i) {
+            channel->receive(meas);
+            res.latency[i] = now_ns() - meas.queued_us;
+            if (static_cast<unsigned>(meas.data.heater.level) != i) {
+                res.ordered = false;
+            }
+        }
+    });
+
+    measurement meas = {};
+    meas.id = LEVEL;
+    int64_t next = now_ns();
+    for (unsigned i = 0; i < count; ++i) {
+        if (gap_ns) {
+            // sleep, a spinning producer would starve the consumer on a
+            // single core
+            std::this_thread::sleep_until(
+                std::chrono::steady_clock::time_point(
+                    std::chrono::nanoseconds(next)));
+            next += gap_ns;
+        }
+        meas.data.heater.level = i;
+        meas.queued_us = now_ns();
+        while (!channel->send(meas)) {
+            ++res.full;
+            std::this_thread::yield();
+            meas.queued_us = now_ns();
+        }
+    }
+    consumer.join();
+
+    res.msgs_per_s = count * 1e9 / (now_ns() - start);
+    std::sort(res.latency.begin(), res.latency.end());
+    return res;
+}
+
+void print(const char* name, const result& res)
+{
+    const auto& l = res.latency;
+    printf("%-6s %12.0f %10lld %10lld %10lld %12llu %s\n", name,
+           res.msgs_per_s, static_cast<long long>(l[l.size() / 2]),
+           static_cast<long long>(l[l.size() * 99 / 100]),
+           static_cast<long long>(l.back()),
+           static_cast<unsigned long long>(res.full),
+           res.ordered ? "" : "OUT OF ORDER");
+}
+
+/**
+ * Stress test: random producer and consumer pauses exercise the full ring
+ * and the sleep and wakeup paths; every value must arrive once, in order.
+ */
+bool stress(unsigned count)
+{
+    ring_channel channel;
+    bool ok = true;
+
+    std::thread consumer([&] {
+        measurement meas;
+        unsigned seed = 2;
+        for (unsigned i = 0; i < count; ++i) {
+            channel.receive(meas);
+            if (static_cast<unsigned>(meas.data.heater.level) != i) {
+                fprintf(stderr, "expected %u, got %d\n", i,
+                        meas.data.heater.level);
+                ok = false;
+                return;
+            }
+            if (!(rand_r(&seed) & 0xfff)) {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+    });
+
+    measurement meas = {};
+    unsigned seed = 1;
+    for (unsigned i = 0; i < count && ok; ++i) {
+        meas.data.heater.level = i;
+        while (!channel.send(meas)) {
+            std::this_thread::yield();
+        }
+        if (!(rand_r(&seed) & 0xfff)) {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+    consumer.join();
+    return ok;
+}
+
+void usage(const char* app)
+{
+    printf("Usage: %s [-n COUNT] [-g GAP_NS] [-s]\n", app);
+    printf("  -n  measurements per run (1000000)\n");
+    printf("  -g  producer pause for the paced latency run (20000)\n");
+    printf("  -s  stress test only\n");
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    unsigned count = 1000000;
+    int64_t gap_ns = 20000;
+    bool stress_only = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            count = strtoul(argv[++i], nullptr, 0);
+        } else if (!strcmp(argv[i], "-g") && i + 1 < argc) {
+            gap_ns = strtoll(argv[++i], nullptr, 0);
+        } else if (!strcmp(argv[i], "-s")) {
+            stress_only = true;
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (!count) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (!stress(count)) {
+        printf("stress: FAILED\n");
+        return EXIT_FAILURE;
+    }
+    printf("stress: %u measurements in order\n", count);
+    if (stress_only) {
+        return EXIT_SUCCESS;
+    }
+
+    printf("entries: %u, measurement: %zu bytes\n", SPSC_RING_SIZE,
+           sizeof(measurement));
+    printf("%-6s %12s %10s %10s %10s %12s\n", "path", "msg/s", "p50 ns",
+           "p99 ns", "max ns", "full");
+    printf("back-to-back:\n");
+    print("ring", run<ring_channel>(count, 0));
+    print("queue", run<queue_channel>(count, 0));
+    const unsigned paced = std::max(1u, static_cast<unsigned>(
+        std::min<int64_t>(count, 2000000000LL / std::max<int64_t>(gap_ns, 1))));
+    printf("paced, %lld ns apart:\n", static_cast<long long>(gap_ns));
+    print("ring", run<ring_channel>(paced, gap_ns));
+    print("queue", run<queue_channel>(paced, gap_ns));
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: MIT
+// Topic and JSON field to measurement bindings.
+
+#include "ingest.h"
+
+#define HOME   "home/kallio/"
+#define ZIGBEE "zigbee2mqtt/"
+
+// Home automation message, identified by the "id" field
+#define HOME_ID(id) { "id", id, 0 }
+
+// Door sensor: contact false means open
+#define DOOR_SENSOR(name) \
+    { .topic = ZIGBEE name, .key = "contact", .kind = FIELD_BOOL, \
+      .transform = TRANSFORM_GROUP, .invert = true, .target = DOOR }
+
+// Water leak sensor
+#define LEAK_SENSOR(name) \
+    { .topic = ZIGBEE name, .key = "water_leak", .kind = FIELD_BOOL, \
+      .transform = TRANSFORM_GROUP, .target = FLOOD }
+
+// Heater relay of a shelly1, selected by the contact number
+#define HEATER_RELAY(contact, heater) \
+    { .topic = HOME "relay/+/shelly1/state", \
+      .match = { HOME_ID("relay"), { "contact", NULL, contact } }, \
+      .key = "state", .kind = FIELD_BOOL, .transform = TRANSFORM_SWITCH, \
+      .target = heater }
+
+const struct binding bindings[] = {
+    { .topic = HOME "thermostat/+/parameters/#",
+      .match = { HOME_ID("thermostat") },
+      .key = "value", .kind = FIELD_NUMBER, .transform = TRANSFORM_VALUE,
+      .target = LEVEL },
+    { .topic = HOME "thermostat/+/parameters/#",
+      .match = { HOME_ID("temperature"), { "sensor", "ntc", 0 } },
+      .key = "value", .kind = FIELD_NUMBER, .transform = TRANSFORM_VALUE,
+      .target = TEMPERATURE },
+    { .topic = HOME "relay/0/shellyplus1pm/state",
+      .match = { HOME_ID("relay"), { "device", "shellyplus1pm", 0 } },
+      .key = "state", .kind = FIELD_BOOL, .transform = TRANSFORM_LOAD,
+      .aux = "power", .threshold = 10.0f, .target = CARHEATER },
+    HEATER_RELAY(0, SOLHEAT),
+    HEATER_RELAY(2, STOCKHEAT),
+    HEATER_RELAY(3, OILBURNER),
+    { .topic = HOME "elprice/currentquart",
+      .match = { HOME_ID("elprice") },
+      .key = "price", .kind = FIELD_NUMBER, .transform = TRANSFORM_PRICE,
+      .aux = "pricestate", .target = PRICE },
+    { .topic = HOME "elprice/daystats/#",
+      .match = { HOME_ID("daystats") },
+      .key = "avg", .kind = FIELD_NUMBER, .transform = TRANSFORM_DAY_PRICE,
+      .aux = "weekday", .target = AVGPRICE },
+    DOOR_SENSOR("store_door"),
+    DOOR_SENSOR("boiler_door"),
+    DOOR_SENSOR("balkong_door"),
+    DOOR_SENSOR("front_door"),
+    LEAK_SENSOR("kitchen_trash"),
+    LEAK_SENSOR("lattia"),
+    LEAK_SENSOR("tiskikone"),
+};
+
+const size_t num_bindings = sizeof(bindings) / sizeof(bindings[0]);
@@ -0,0 +1,193 @@
+// SPDX-License-Identifier: MIT
+// Capture of received MQTT messages to a RAM ring buffer.
+
+#include "capture.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <string.h>
+
+// Max size of a record header: time and two varints
+#define HEADER_MAX (4 + 5 + 5)
+
+// Ring position
+#define AT(offset) ((offset) & (CAPTURE_RING_SIZE - 1))
+
+static uint8_t ring[CAPTURE_RING_SIZE];
+// Free running offsets of the oldest record and of the end of the newest
+static uint32_t tail;
+static uint32_t head;
+
+// Record being assembled from fragments, visible when head is moved
+static bool pending;
+static uint32_t pending_payload; // offset of the payload
+static uint32_t pending_end;
+
+// A fragment was missed, the pending record is incomplete
+static bool lost;
+
+static volatile bool enabled;
+static SemaphoreHandle_t lock;
+static struct capture_stats stats;
+
+static size_t put_varint(uint8_t* out, uint32_t value)
+{
+    size_t size = 0;
+    while (value >= 0x80) {
+        out[size++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[size++] = (uint8_t)value;
+    return size;
+}
+
+static size_t get_varint(const uint8_t* in, uint32_t* value)
+{
+    size_t size = 0;
+    *value = 0;
+    do {
+        *value |= (uint32_t)(in[size] & 0x7f) << (7 * size);
+    } while (in[size++] & 0x80 && size < 5);
+    return size;
+}
+
+static void ring_write(uint32_t offset, const void* data, size_t size)
+{
+    const size_t first = CAPTURE_RING_SIZE - AT(offset);
+    if (size <= first) {
+        memcpy(&ring[AT(offset)], data, size);
+    } else {
+        memcpy(&ring[AT(offset)], data, first);
+        memcpy(ring, (const uint8_t*)data + first, size - first);
+    }
+}
+
+static void ring_read(uint32_t offset, void* data, size_t size)
+{
+    const size_t first = CAPTURE_RING_SIZE - AT(offset);
+    if (size <= first) {
+        memcpy(data, &ring[AT(offset)], size);
+    } else {
+        memcpy(data, &ring[AT(offset)], first);
+        memcpy((uint8_t*)data + first, ring, size - first);
+    }
+}
+
+/**
+ * Drop the oldest record.
+ */
+static void evict(void)
+{
+    uint8_t header[HEADER_MAX];
+    uint32_t topic_len;
+    uint32_t payload_len;
+
+    ring_read(tail, header, sizeof(header));
+    size_t size = 4;
+    size += get_varint(&header[size], &topic_len);
+    size += get_varint(&header[size], &payload_len);
+    tail += size + topic_len + payload_len;
+    --stats.records;
+    ++stats.evicted;
+}
+
+/**
+ * Start a record, evicting the oldest records to make room for it.
+ */
+static void begin(const struct mqtt_fragment* frag, int64_t time_us)
+{
+    uint8_t header[HEADER_MAX];
+    const uint32_t time_ms = (uint32_t)(time_us / 1000);
+    size_t size = 0;
+
+    header[size++] = (uint8_t)time_ms;
+    header[size++] = (uint8_t)(time_ms >> 8);
+    header[size++] = (uint8_t)(time_ms >> 16);
+    header[size++] = (uint8_t)(time_ms >> 24);
+    size += put_varint(&header[size], frag->topic_len);
+    size += put_varint(&header[size], frag->total);
+
+    const size_t record = size + frag->topic_len + frag->total;
+    if (record > CAPTURE_RECORD_MAX) {
+        ++stats.oversize;
+        return;
+    }
+    while (head + record - tail > CAPTURE_RING_SIZE) {
+        evict();
+    }
+    ring_write(head, header, size);
+    ring_write(head + size, frag->topic, frag->topic_len);
+    pending_payload = head + size + frag->topic_len;
+    pending_end = head + record;
+    pending = true;
+}
+
+void capture_init(bool enable)
+{
+    lock = xSemaphoreCreateMutex();
+    capture_clear();
+    enabled = enable;
+}
+
+void capture_enable(bool enable)
+{
+    enabled = enable;
+}
+
+void capture_fragment(const struct mqtt_fragment* frag, int64_t time_us)
+{
+    if (!enabled) {
+        return;
+    }
+    // the MQTT task never waits for a dump
+    if (xSemaphoreTake(lock, 0) != pdTRUE) {
+        ++stats.missed;
+        lost = true;
+        return;
+    }
+
+    if (lost || frag->offset == 0) {
+        // unfinished record is dropped
+        pending = false;
+        lost = false;
+    }
+    if (frag->offset == 0 && frag->topic) {
+        begin(frag, time_us);
+    }
+    if (pending && frag->offset + frag->length <= pending_end - pending_payload) {
+        ring_write(pending_payload + frag->offset, frag->data, frag->length);
+        if (frag->offset + frag->length == frag->total) {
+            head = pending_end;
+            pending = false;
+            ++stats.records;
+            ++stats.captured;
+        }
+    }
+
+    xSemaphoreGive(lock);
+}
+
+size_t capture_snapshot(uint8_t* out)
+{
+    xSemaphoreTake(lock, portMAX_DELAY);
+    const size_t size = head - tail;
+    ring_read(tail, out, size);
+    xSemaphoreGive(lock);
+    return size;
+}
+
+void capture_clear(void)
+{
+    xSemaphoreTake(lock, portMAX_DELAY);
+    tail = head = 0;
+    pending = false;
+    memset(&stats, 0, sizeof(stats));
+    xSemaphoreGive(lock);
+}
+
+void capture_stats(struct capture_stats* out)
+{
+    *out = stats;
+    out->used = head - tail;
+    out->enabled = enabled;
+}
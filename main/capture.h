@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: MIT
+// Capture of received MQTT messages to a RAM ring buffer.
+//
+// Record format, little endian: time in ms since boot (u32), topic length
+// and payload length (unsigned LEB128 varints), topic, payload. A dump is
+// CAPTURE_MAGIC followed by the records, oldest first.
+
+#pragma once
+
+#include "reassembly.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Ring buffer size in bytes, power of 2
+#ifndef CAPTURE_RING_SIZE
+#define CAPTURE_RING_SIZE 16384
+#endif
+
+// Max record size, larger payloads are not captured
+#define CAPTURE_RECORD_MAX (CAPTURE_RING_SIZE / 2)
+
+// Dump header
+#define CAPTURE_MAGIC "MQCAP1\n"
+#define CAPTURE_MAGIC_LEN 7
+
+// Console dump: the dump in hex, in lines starting with this prefix
+#define CAPTURE_DUMP_PREFIX "=CAP "
+
+/**
+ * Capture statistics.
+ */
+struct capture_stats {
+    uint32_t records;  // records in the ring
+    uint32_t captured; // records written since the last clear
+    uint32_t evicted;  // oldest records overwritten
+    uint32_t missed;   // messages received during a dump or clear
+    uint32_t oversize; // payloads larger than CAPTURE_RECORD_MAX
+    size_t used;       // bytes in the ring
+    bool enabled;
+};
+
+/**
+ * Initialize capture.
+ * @param enable start capturing
+ */
+void capture_init(bool enable);
+
+/**
+ * Start or stop capturing.
+ * @param enable true to capture
+ */
+void capture_enable(bool enable);
+
+/**
+ * Record data event. Fragments are collected into one record, which is
+ * visible after the last fragment. Never blocks: while the ring is being
+ * read the message is counted as missed.
+ * @param frag data event
+ * @param time_us monotonic time of the event
+ */
+void capture_fragment(const struct mqtt_fragment* frag, int64_t time_us);
+
+/**
+ * Copy the records, oldest first, without the dump header.
+ * @param out output buffer of CAPTURE_RING_SIZE bytes
+ * @return number of bytes copied
+ */
+size_t capture_snapshot(uint8_t* out);
+
+/**
+ * Drop all records and reset the counters.
+ */
+void capture_clear(void);
+
+/**
+ * Get capture statistics.
+ * @param stats output statistics
+ */
+void capture_stats(struct capture_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: MIT
+// Serial console commands.
+
+#include "console.h"
+
+#include "capture.h"
+
+#include <esp_console.h>
+#include <esp_log.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Bytes per line of a capture dump
+#define DUMP_LINE 48
+
+static const char* log_tag = "console";
+
+static void dump_line(const uint8_t* data, size_t size)
+{
+    printf(CAPTURE_DUMP_PREFIX);
+    for (size_t i = 0; i < size; ++i) {
+        printf("%02x", data[i]);
+    }
+    printf("\n");
+}
+
+/**
+ * Print the captured records in hex, for the host decoder.
+ */
+static int capture_dump(void)
+{
+    uint8_t* buffer = malloc(CAPTURE_MAGIC_LEN + CAPTURE_RING_SIZE);
+    if (!buffer) {
+        printf("Out of memory\n");
+        return 1;
+    }
+    memcpy(buffer, CAPTURE_MAGIC, CAPTURE_MAGIC_LEN);
+    const size_t size =
+        CAPTURE_MAGIC_LEN + capture_snapshot(buffer + CAPTURE_MAGIC_LEN);
+    for (size_t offset = 0; offset < size; offset += DUMP_LINE) {
+        dump_line(buffer + offset,
+                  size - offset < DUMP_LINE ? size - offset : DUMP_LINE);
+    }
+    free(buffer);
+    return 0;
+}
+
+static int cmd_capture(int argc, char** argv)
+{
+    const char* action = argc > 1 ? argv[1] : "stats";
+
+    if (!strcmp(action, "on") || !strcmp(action, "off")) {
+        capture_enable(!strcmp(action, "on"));
+    } else if (!strcmp(action, "clear")) {
+        capture_clear();
+    } else if (!strcmp(action, "dump")) {
+        return capture_dump();
+    } else if (strcmp(action, "stats")) {
+        printf("Unknown action %s\n", action);
+        return 1;
+    }
+
+    struct capture_stats stats;
+    capture_stats(&stats);
+    printf("capture %s: %lu records, %u/%u bytes, %lu captured, "
+           "%lu evicted, %lu missed, %lu oversize\n",
+           stats.enabled ? "on" : "off", (unsigned long)stats.records,
+           (unsigned)stats.used, (unsigned)CAPTURE_RING_SIZE,
+           (unsigned long)stats.captured, (unsigned long)stats.evicted,
+           (unsigned long)stats.missed, (unsigned long)stats.oversize);
+    return 0;
+}
+
+void console_start(void)
+{
+    esp_console_repl_t* repl = NULL;
+    esp_console_repl_config_t repl_config = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
+    esp_console_dev_uart_config_t uart_config =
+        ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
+    repl_config.prompt = "monitor>";
+
+    if (esp_console_new_repl_uart(&uart_config, &repl_config, &repl) !=
+        ESP_OK) {
+        ESP_LOGE(log_tag, "Console init failed");
+        return;
+    }
+    esp_console_register_help_command();
+
+    const esp_console_cmd_t capture = {
+        .command = "capture",
+        .help = "MQTT traffic capture: on, off, clear, dump or stats",
+        .hint = "[on|off|clear|dump|stats]",
+        .func = cmd_capture,
+    };
+    esp_console_cmd_register(&capture);
+
+    esp_console_start_repl(repl);
+}
+
+void console_register(const char* command, const char* hint,
+                      const char* help, int (*func)(int argc, char** argv))
+{
+    const esp_console_cmd_t cmd = {
+        .command = command,
+        .help = help,
+        .hint = hint,
+        .func = func,
+    };
+    if (esp_console_cmd_register(&cmd) != ESP_OK) {
+        ESP_LOGE(log_tag, "Unable to add command %s", command);
+    }
+}
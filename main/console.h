@@ -0,0 +1,27 @@
+// SPDX-License-Identifier: MIT
+// Serial console commands.
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Start the console on the UART used for logging.
+ */
+void console_start(void);
+
+/**
+ * Add command, called after console_start.
+ * @param command command name
+ * @param hint argument hint
+ * @param help help text
+ * @param func command handler, returns nonzero on error
+ */
+void console_register(const char* command, const char* hint,
+                      const char* help, int (*func)(int argc, char** argv));
+
+#ifdef __cplusplus
+}
+#endif
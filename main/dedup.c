@@ -0,0 +1,26 @@
+// SPDX-License-Identifier: MIT
+// Per-topic cache of payload hashes and field values to skip repeated
+// messages.
+
+#include "dedup.h"
+
+#include <string.h>
+
+static struct dedup_entry entries[DEDUP_ENTRIES];
+
+struct dedup_entry* dedup_entry(uint32_t topic, int route)
+{
+    struct dedup_entry* entry = &entries[topic & (DEDUP_ENTRIES - 1)];
+    if (entry->topic != topic || entry->route != route) {
+        entry->topic = topic;
+        entry->route = route;
+        entry->has_payload = false;
+        entry->has_fields = false;
+    }
+    return entry;
+}
+
+void dedup_reset(void)
+{
+    memset(entries, 0, sizeof(entries));
+}
@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: MIT
+// Per-topic cache of payload hashes and field values to skip repeated
+// messages.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Number of cached topics, power of 2
+#ifndef DEDUP_ENTRIES
+#define DEDUP_ENTRIES 256
+#endif
+
+// Bytes of the extracted field values kept per topic, values that do not
+// fit are not cached
+#ifndef DEDUP_FIELDS_SIZE
+#define DEDUP_FIELDS_SIZE 32
+#endif
+
+// Initial value of dedup_hash
+#define DEDUP_HASH_INIT 2166136261u
+
+/**
+ * Last message seen on a topic. The cache is direct mapped: topics with
+ * the same slot evict each other.
+ */
+struct dedup_entry {
+    uint32_t topic;   // topic hash
+    int route;        // route of the topic
+    uint32_t payload; // hash of the whole payload
+    uint8_t fields[DEDUP_FIELDS_SIZE]; // extracted field values, packed
+    uint8_t fields_len;
+    bool has_payload;
+    bool has_fields;
+};
+
+/**
+ * Hash data with FNV-1a.
+ * @param hash previous hash or DEDUP_HASH_INIT
+ * @param data data to hash
+ * @param size data size
+ * @return updated hash
+ */
+static inline uint32_t dedup_hash(uint32_t hash, const void* data, size_t size)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Get cache entry of a topic, an entry of another topic is reset.
+ * @param topic topic hash
+ * @param route route of the topic
+ * @return cache entry
+ */
+struct dedup_entry* dedup_entry(uint32_t topic, int route);
+
+/**
+ * Forget all cached topics.
+ */
+void dedup_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: MIT
+// Dirty rectangles of the screen.
+
+#include "dirty_rect.h"
+
+#include <algorithm>
+
+/**
+ * Get bounding box of two rectangles.
+ */
+static struct rect rect_union(const struct rect* a, const struct rect* b)
+{
+    const size_t x = std::min(a->x, b->x);
+    const size_t y = std::min(a->y, b->y);
+    const size_t x_end = std::max(a->x + a->width, b->x + b->width);
+    const size_t y_end = std::max(a->y + a->height, b->y + b->height);
+    return { x, y, x_end - x, y_end - y };
+}
+
+/**
+ * Get number of pixels added by merging two rectangles.
+ */
+static size_t merge_cost(const struct rect* a, const struct rect* b)
+{
+    const struct rect u = rect_union(a, b);
+    const size_t area = u.width * u.height;
+    const size_t sum = a->width * a->height + b->width * b->height;
+    return area > sum ? area - sum : 0;
+}
+
+void dirty_add(struct dirty_list* list, const struct rect* r)
+{
+    struct rect next = *r;
+
+    if (!next.width || !next.height) {
+        return;
+    }
+
+    // absorb every rectangle that overlaps or is cheap to merge, merged
+    // rectangle may in turn absorb others
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (size_t i = 0; i < list->count; ++i) {
+            const struct rect* cur = &list->rects[i];
+            if (rect_intersects(cur, &next) ||
+                merge_cost(cur, &next) <= DIRTY_MERGE_SLACK) {
+                next = rect_union(cur, &next);
+                list->rects[i] = list->rects[--list->count];
+                merged = true;
+                break;
+            }
+        }
+    }
+
+    if (list->count == DIRTY_RECTS) {
+        // list is full: merge with the cheapest neighbour
+        size_t best = 0;
+        for (size_t i = 1; i < list->count; ++i) {
+            if (merge_cost(&list->rects[i], &next) <
+                merge_cost(&list->rects[best], &next)) {
+                best = i;
+            }
+        }
+        next = rect_union(&list->rects[best], &next);
+        list->rects[best] = list->rects[--list->count];
+        dirty_add(list, &next);
+        return;
+    }
+
+    list->rects[list->count++] = next;
+}
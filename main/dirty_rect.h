@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: MIT
+// Dirty rectangles of the screen.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Max number of tracked rectangles
+#define DIRTY_RECTS 16
+
+// Unchanged pixels allowed in a merged rectangle, about the bus cost of
+// one extra address window per strip
+#define DIRTY_MERGE_SLACK 64
+
+struct rect {
+    size_t x, y;
+    size_t width, height;
+};
+
+/**
+ * List of non-overlapping regions to be sent to the panel.
+ */
+struct dirty_list {
+    struct rect rects[DIRTY_RECTS];
+    size_t count;
+};
+
+/**
+ * Add rectangle to the list, merging it with close rectangles.
+ * @param list dirty list
+ * @param r rectangle to add
+ */
+void dirty_add(struct dirty_list* list, const struct rect* r);
+
+/**
+ * Check if two rectangles intersect.
+ * @param a,b rectangles to check
+ * @return true if rectangles have common pixels
+ */
+static inline bool rect_intersects(const struct rect* a, const struct rect* b)
+{
+    return a->x < b->x + b->width && b->x < a->x + a->width &&
+        a->y < b->y + b->height && b->y < a->y + a->height;
+}
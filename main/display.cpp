@@ -7,63 +7,563 @@ extern "C" {
 #include "resources.h"
 }
 
-#define LGFX_WT32_SC01
-#define HEIGHT_INDICATOR 33
+#include "display_backend.h"
+#include "display_format.h"
+#include "dirty_rect.h"
+#include "glyph_cache.h"
+
+#include <algorithm>
 
-#include <LGFX_AUTODETECT.hpp>
+#define HEIGHT_INDICATOR 33
 
-// LCD handle
-static LGFX lcd;
+// Height of each of the two off-screen strips used in compose mode, strips
+// span the full display width
+#ifndef DISPLAY_STRIP_HEIGHT
+#define DISPLAY_STRIP_HEIGHT 8
+#endif
+
+// Bus bytes spent on setting address window (CASET, RASET, RAMWR)
+#define WINDOW_BYTES 11
+
+// Max number of digits in a number with retained state
+#define NUMBER_DIGITS 4
+// Max number of indicators with retained state
+#define MAX_INDICATORS 8
+// Number of price widgets (current and average price)
+#define PRICE_WIDGETS 2
+// Cells of a price widget: whole digits, fraction digits and dot
+#define PRICE_CELLS (2 * NUMBER_DIGITS + 1)
+// Retained primitives drawn without a cell id, the oldest one is dropped
+// when all are used
+#define LOOSE_CELLS 16
+
+// Retained screen content, one cell per drawn primitive
+enum cell_id {
+    CELL_STATIC = 0, // colon and dots
+    CELL_COMM = CELL_STATIC + 3,
+    CELL_HOURS = CELL_COMM + 3,
+    CELL_MINUTES = CELL_HOURS + NUMBER_DIGITS,
+    CELL_SECONDS = CELL_MINUTES + NUMBER_DIGITS,
+    CELL_TEMP_WHOLE = CELL_SECONDS + NUMBER_DIGITS,
+    CELL_TEMP_FRACT = CELL_TEMP_WHOLE + NUMBER_DIGITS,
+    CELL_LEVEL = CELL_TEMP_FRACT + NUMBER_DIGITS,
+    CELL_PRICE = CELL_LEVEL + NUMBER_DIGITS,
+    CELL_INDICATOR = CELL_PRICE + PRICE_WIDGETS * PRICE_CELLS,
+    CELL_ICON = CELL_INDICATOR + MAX_INDICATORS,
+    CELL_COUNT = CELL_ICON + MAX_INDICATORS,
+    CELL_NONE = CELL_COUNT // primitive without retained state
+};
+
+enum cell_kind {
+    CELL_EMPTY,
+    CELL_FILL,
+    CELL_MASK,
+};
+
+// Primitive drawn on screen
+struct cell {
+    enum cell_kind kind;
+    struct mask_area area; // masked image, CELL_MASK only
+    size_t x, y;
+    size_t width, height;
+    uint32_t color;
+    uint64_t order = 0; // draw order, later cells cover earlier ones
+    bool stale = false; // screen may differ, redrawn by the next put_cell()
+};
+
+// Output device
+static display_backend* lcd;
+static display_backend* backend_override;
+static bool bus_open;
+static struct display_stats stats;
 static int ind_spacing = 10;
+// Last rendered content of every cell, followed by loose cells of CELL_NONE
+// primitives
+static struct cell cells[CELL_COUNT + LOOSE_CELLS];
+static uint64_t draw_order;
+// Compose mode: cells are only updated, display_flush() draws them
+static bool compose;
+static struct dirty_list dirty;
+// Off-screen strips, one is rendered while the other one is transferred
+static display_format::pixel strips[2][DISPLAY_WIDTH * DISPLAY_STRIP_HEIGHT];
+static size_t strip_next;
+static bool strip_busy[2];
+// Timing of the current flush
+static struct {
+    uint64_t render_us;
+    uint64_t wait_us;
+} frame;
+// Left top corners of price widgets
+static struct {
+    bool used;
+    int x, y;
+} price_pos[PRICE_WIDGETS];
+
+/**
+ * Get color value in the display pixel format.
+ * @param r,g,b color components
+ * @return color value
+ */
+static constexpr uint32_t rgb(uint8_t r, uint8_t g, uint8_t b)
+{
+    return display_format::color(r, g, b);
+}
+
+/**
+ * Start drawing for one display_* call, the bus transaction is opened with
+ * the first primitive that has to be drawn.
+ */
+static void begin_draw(void)
+{
+    ++stats.calls;
+}
+
+/**
+ * Open bus transaction if not opened yet.
+ */
+static void open_bus(void)
+{
+    if (!bus_open) {
+        bus_open = true;
+        ++stats.transactions;
+        lcd->start_write();
+    }
+}
+
+/**
+ * Finish drawing, close bus transaction.
+ */
+static void end_draw(void)
+{
+    if (bus_open) {
+        bus_open = false;
+        lcd->end_write();
+    }
+}
+
+/**
+ * Blitting core, moves pixels of the specified format to the backend.
+ */
+template <class Format>
+struct blitter {
+    using pixel = typename Format::pixel;
+
+    /**
+     * Set address window for following runs.
+     * @param x,y coordinates of the left top corner
+     * @param width,height size of the window
+     */
+    static void set_window(size_t x, size_t y, size_t width, size_t height)
+    {
+        open_bus();
+        ++stats.windows;
+        stats.bus_bytes += WINDOW_BYTES;
+        lcd->set_window(x, y, width, height);
+    }
+
+    /**
+     * Write run of same colored pixels into the current window.
+     * @param color output color
+     * @param length number of pixels
+     */
+    static void write_run(pixel color, size_t length)
+    {
+        stats.pixels += length;
+        stats.bus_bytes += length * Format::bus_bytes;
+        lcd->write_color(color, length);
+    }
+
+    /**
+     * Draw 1-bpp mask as a single window filled with runs of
+     * foreground/background pixels.
+     * @param area mask area to draw
+     * @param x,y coordinates of the left top corner
+     * @param color output color
+     */
+    static void draw_mask(const struct mask_area* area, size_t x, size_t y,
+                              pixel color)
+    {
+        struct mask_runs decoded;
+
+        set_window(x, y, area->width, area->height);
+
+        if (glyph_cache_get(area, &decoded)) {
+            for (size_t i = 0; i < decoded.count; ++i) {
+                if (decoded.runs[i]) {
+                    write_run(i & 1 ? color : 0, decoded.runs[i]);
+                }
+            }
+            return;
+        }
+
+        // not cacheable, decode on the fly
+        bool run_bit = false;
+        size_t run_length = 0;
+        for (size_t dy = 0; dy < area->height; ++dy) {
+            for (size_t dx = 0; dx < area->width; ++dx) {
+                const bool bit = mask_bit(area, dx, dy);
+                if (bit != run_bit) {
+                    if (run_length) {
+                        write_run(run_bit ? color : 0, run_length);
+                    }
+                    run_bit = bit;
+                    run_length = 0;
+                }
+                ++run_length;
+            }
+        }
+        if (run_length) {
+            write_run(run_bit ? color : 0, run_length);
+        }
+    }
+
+    /**
+     * Draw primitive described by the cell.
+     * @param c cell to draw
+     */
+    static void draw_cell(const struct cell* c)
+    {
+        if (c->kind == CELL_MASK) {
+            draw_mask(&c->area, c->x, c->y, c->color);
+        } else if (c->kind == CELL_FILL) {
+            open_bus();
+            ++stats.windows;
+            stats.pixels += c->width * c->height;
+            stats.bus_bytes +=
+                WINDOW_BYTES + c->width * c->height * Format::bus_bytes;
+            lcd->fill_rect(c->x, c->y, c->width, c->height, c->color);
+        }
+    }
+
+    /**
+     * Start writing pixels into the current window, data must stay unchanged
+     * until wait_bus().
+     * @param data pixels to write
+     * @param length number of pixels
+     */
+    static void push_pixels_async(const pixel* data, size_t length)
+    {
+        stats.pixels += length;
+        stats.bus_bytes += length * Format::bus_bytes;
+        lcd->push_pixels_async(data, length);
+    }
+
+    /**
+     * Wait for all transfers, all strips can be reused afterwards.
+     */
+    static void wait_bus(void)
+    {
+        const uint64_t start = display_now_us();
+        lcd->wait();
+        frame.wait_us += display_now_us() - start;
+        strip_busy[0] = false;
+        strip_busy[1] = false;
+    }
+
+    /**
+     * Render cell into off-screen buffer.
+     * @param c cell to render
+     * @param clip screen area covered by the buffer
+     * @param buf buffer, clip->width pixels per row
+     */
+    static void render_cell(const struct cell* c, const struct rect* clip,
+                            pixel* buf)
+    {
+        const size_t x0 = std::max(c->x, clip->x);
+        const size_t y0 = std::max(c->y, clip->y);
+        const size_t x1 = std::min(c->x + c->width, clip->x + clip->width);
+        const size_t y1 = std::min(c->y + c->height, clip->y + clip->height);
+        // strips are pushed in bus order
+        const pixel color = Format::to_bus(c->color);
+
+        for (size_t y = y0; y < y1; ++y) {
+            pixel* row = buf + (y - clip->y) * clip->width - clip->x;
+            if (c->kind == CELL_FILL) {
+                std::fill(row + x0, row + x1, color);
+                continue;
+            }
+            for (size_t x = x0; x < x1; ++x) {
+                row[x] = mask_bit(&c->area, x - c->x, y - c->y) ? color : 0;
+            }
+        }
+    }
+
+    /**
+     * Compose screen region from cells strip by strip and send it.
+     * Strips are double-buffered: the next strip is rendered while the
+     * previous one is transferred.
+     * @param r screen region
+     */
+    static void flush_rect(const struct rect* r)
+    {
+        const size_t capacity = sizeof(strips[0]) / sizeof(strips[0][0]);
+        const size_t rows =
+            std::max<size_t>(1, std::min(r->height, capacity / r->width));
+        // cells in the region, overlapping cells are rendered in draw order
+        const struct cell* visible[CELL_COUNT + LOOSE_CELLS];
+        size_t count = 0;
+
+        for (const struct cell& c : cells) {
+            const struct rect bounds = { c.x, c.y, c.width, c.height };
+            if (c.kind != CELL_EMPTY && rect_intersects(&bounds, r)) {
+                visible[count++] = &c;
+            }
+        }
+        std::sort(visible, visible + count,
+                  [](const struct cell* a, const struct cell* b) {
+                      return a->order < b->order;
+                  });
+
+        for (size_t y = r->y; y < r->y + r->height; y += rows) {
+            const struct rect band = {
+                r->x,
+                y,
+                r->width,
+                std::min(rows, r->y + r->height - y),
+            };
+            pixel* buf = strips[strip_next];
+            if (strip_busy[strip_next]) {
+                wait_bus();
+            }
+
+            const uint64_t render_start = display_now_us();
+            std::fill_n(buf, band.width * band.height, 0);
+            for (size_t i = 0; i < count; ++i) {
+                const struct cell* c = visible[i];
+                const struct rect bounds = { c->x, c->y, c->width, c->height };
+                if (rect_intersects(&bounds, &band)) {
+                    render_cell(c, &band, buf);
+                }
+            }
+            const uint64_t render_end = display_now_us();
+            frame.render_us += render_end - render_start;
+
+            set_window(band.x, band.y, band.width, band.height);
+            push_pixels_async(buf, band.width * band.height);
+            frame.wait_us += display_now_us() - render_end;
+            strip_busy[strip_next] = true;
+            strip_next ^= 1;
+        }
+    }
+
+    /**
+     * Walk row spans of pixels that differ between two masks of the same size.
+     * Spans separated by a gap cheaper to rewrite than a new window are joined.
+     * @param a,b masks to compare
+     * @param span callback called with row, first and last+1 column of a span
+     */
+    template <typename F>
+    static void for_each_diff_span(const struct mask_area* a,
+                                       const struct mask_area* b, F&& span)
+    {
+        for (size_t y = 0; y < a->height; ++y) {
+            size_t start = SIZE_MAX;
+            size_t end = 0;
+            for (size_t x = 0; x < a->width; ++x) {
+                if (mask_bit(a, x, y) == mask_bit(b, x, y)) {
+                    continue;
+                }
+                if (start == SIZE_MAX) {
+                    start = x;
+                } else if ((x - end) * Format::bus_bytes > WINDOW_BYTES) {
+                    span(y, start, end);
+                    start = x;
+                }
+                end = x + 1;
+            }
+            if (start != SIZE_MAX) {
+                span(y, start, end);
+            }
+        }
+    }
+
+    /**
+     * Draw transition between two symbols of the same font at the same place,
+     * only pixels that differ between the symbols are written.
+     * @param prev currently shown cell
+     * @param next new cell content
+     * @return false if the transition costs more than a full redraw
+     */
+    static bool draw_transition(const struct cell* prev, const struct cell* next)
+    {
+        const struct mask_area* area = &next->area;
+        const uint64_t full_cost =
+            WINDOW_BYTES + area->width * area->height * Format::bus_bytes;
+        uint64_t cost = 0;
+
+        for_each_diff_span(&prev->area, area,
+                           [&cost](size_t, size_t start, size_t end) {
+                               cost += WINDOW_BYTES +
+                                   (end - start) * Format::bus_bytes;
+                           });
+        if (cost >= full_cost) {
+            return false;
+        }
+
+        for_each_diff_span(
+            &prev->area, area, [next, area](size_t y, size_t start, size_t end) {
+                set_window(next->x + start, next->y + y, end - start, 1);
+                bool run_bit = mask_bit(area, start, y);
+                size_t run_length = 0;
+                for (size_t x = start; x < end; ++x) {
+                    const bool bit = mask_bit(area, x, y);
+                    if (bit != run_bit) {
+                        write_run(run_bit ? next->color : 0, run_length);
+                        run_bit = bit;
+                        run_length = 0;
+                    }
+                    ++run_length;
+                }
+                write_run(run_bit ? next->color : 0, run_length);
+            });
+        ++stats.draws_transition;
+        return true;
+    }
+};
+
+using blit = blitter<display_format>;
+
+/**
+ * Get loose cell for a primitive without cell id: a cell the primitive
+ * fully covers, otherwise the oldest or a free one.
+ * @param next primitive to retain
+ * @return cell id
+ */
+static size_t loose_cell(const struct cell* next)
+{
+    size_t oldest = CELL_COUNT;
+
+    for (size_t id = CELL_COUNT; id < CELL_COUNT + LOOSE_CELLS; ++id) {
+        const struct cell* c = &cells[id];
+        if (c->kind != CELL_EMPTY && c->x >= next->x && c->y >= next->y &&
+            c->x + c->width <= next->x + next->width &&
+            c->y + c->height <= next->y + next->height) {
+            return id;
+        }
+        // free cells have order 0
+        if (c->order < cells[oldest].order) {
+            oldest = id;
+        }
+    }
+    return oldest;
+}
+
+/**
+ * Draw primitive unless the cell already shows the same content.
+ * @param id cell id, CELL_NONE to draw unconditionally
+ * @param next new cell content
+ */
+static void put_cell(size_t id, const struct cell* next)
+{
+    const bool loose = id >= CELL_COUNT;
+    if (loose) {
+        id = loose_cell(next);
+    }
+    struct cell* prev = &cells[id];
+    if (!loose && !prev->stale && prev->kind == next->kind &&
+        prev->x == next->x && prev->y == next->y && prev->width == next->width &&
+        prev->height == next->height && prev->color == next->color &&
+        prev->area.mask == next->area.mask &&
+        prev->area.offset == next->area.offset) {
+        ++stats.draws_skipped;
+        return;
+    }
+    ++stats.draws_performed;
+    if (compose) {
+        // drawn by display_flush()
+        const struct rect prev_bounds = { prev->x, prev->y, prev->width,
+                                          prev->height };
+        const struct rect next_bounds = { next->x, next->y, next->width,
+                                          next->height };
+        if (prev->kind != CELL_EMPTY) {
+            dirty_add(&dirty, &prev_bounds);
+        }
+        dirty_add(&dirty, &next_bounds);
+        *prev = *next;
+        prev->order = ++draw_order;
+        return;
+    }
+    // other symbol of the same font at the same place
+    const bool same_font = !loose && !prev->stale && prev->kind == CELL_MASK &&
+        next->kind == CELL_MASK && prev->x == next->x &&
+        prev->y == next->y && prev->width == next->width &&
+        prev->height == next->height && prev->color == next->color &&
+        prev->area.mask == next->area.mask &&
+        prev->area.stride == next->area.stride;
+    if (!same_font || !blit::draw_transition(prev, next)) {
+        blit::draw_cell(next);
+    }
+    *prev = *next;
+    prev->order = ++draw_order;
+}
 
 /**
  * Draw masked image.
+ * @param id cell id
  * @param img pointer to the image instance to use
  * @param x,y coordinates of the left top corner
  * @param color output color
  */
-static void draw_image(const struct image* img, size_t x, size_t y,
+static void draw_image(size_t id, const struct image* img, size_t x, size_t y,
                        uint32_t color)
 {
-    for (size_t dy = 0; dy < img->height; ++dy) {
-        const size_t disp_y = dy + y;
-        for (size_t dx = 0; dx < img->width; ++dx) {
-            const size_t disp_x = dx + x;
-            const uint32_t pixel = color * image_bit(img, dx, dy);
-            lcd.writePixel(disp_x, disp_y, pixel);
-        }
-    }
+    const struct cell next = {
+        .kind = CELL_MASK,
+        .area = {
+            .mask = img->mask,
+            .stride = img->stride,
+            .offset = 0,
+            .width = img->width,
+            .height = img->height,
+        },
+        .x = x,
+        .y = y,
+        .width = img->width,
+        .height = img->height,
+        .color = color,
+    };
+    put_cell(id, &next);
 }
 
 /**
  * Draw masked image from the font.
+ * @param id cell id
  * @param font pointer to the font instance to use
  * @param index index of the font symbol
  * @param x,y coordinates of the left top corner
  * @param color output color
  */
-static void draw_font(const struct font* font, size_t index, size_t x, size_t y,
-                      uint32_t color)
+static void draw_font(size_t id, const struct font* font, size_t index,
+                      size_t x, size_t y, uint32_t color)
 {
-    for (size_t dy = 0; dy < font->height; ++dy) {
-        const size_t disp_y = dy + y;
-        for (size_t dx = 0; dx < font->width; ++dx) {
-            const size_t disp_x = dx + x;
-            const uint32_t pixel = color * font_bit(font, index, dx, dy);
-            lcd.writePixel(disp_x, disp_y, pixel);
-        }
-    }
+    const struct cell next = {
+        .kind = CELL_MASK,
+        .area = {
+            .mask = font->mask,
+            .stride = font->stride,
+            .offset = index * font->width,
+            .width = font->width,
+            .height = font->height,
+        },
+        .x = x,
+        .y = y,
+        .width = font->width,
+        .height = font->height,
+        .color = color,
+    };
+    put_cell(id, &next);
 }
 
 /**
- * Draw number.
+ * Draw number, every digit has its own cell.
+ * @param id cell id of the first digit, NUMBER_DIGITS cells are used
  * @param font pointer to the font instance to use
  * @param x,y coordinates of the left top corner
  * @param color output color
  * @param value number to draw
  * @param min_digits minimal number of digits to draw
  */
-static void draw_number(const struct font* font, size_t x, size_t y,
+static void draw_number(size_t id, const struct font* font, size_t x, size_t y,
                         uint32_t color, size_t value, size_t min_digits)
 {
     size_t bcd = 0;
@@ -81,56 +581,152 @@ static void draw_number(const struct font* font, size_t x, size_t y,
         const size_t start_bit = (digits - i - 1) * 4;
         const uint8_t digit = (bcd >> start_bit) & 0xf;
         const size_t x_offset = x + (font->width + font->spacing) * i;
-        draw_font(font, digit, x_offset, y, color);
+        const size_t cell = id < CELL_COUNT && i < NUMBER_DIGITS
+            ? id + i
+            : static_cast<size_t>(CELL_NONE);
+        draw_font(cell, font, digit, x_offset, y, color);
     }
 }
 
 /**
  * Fill rectangle with specified color.
+ * @param id cell id
  * @param x,y coordinates of the left top corner
  * @param width,height size of the rectangle
  * @param color output color
  */
-static void fill(size_t x, size_t y, size_t width, size_t height,
+static void fill(size_t id, size_t x, size_t y, size_t width, size_t height,
                  uint32_t color)
 {
-    const size_t max_x = x + width;
-    const size_t max_y = y + height;
-    for (; y < max_y; ++y) {
-        for (size_t dx = x; dx < max_x; ++dx) {
-            lcd.writePixel(dx, y, color);
+    const struct cell next = {
+        .kind = CELL_FILL,
+        .area = {},
+        .x = x,
+        .y = y,
+        .width = width,
+        .height = height,
+        .color = color,
+    };
+    put_cell(id, &next);
+}
+
+/**
+ * Get cells of the price widget at specified position.
+ * @param x,y left top corner of the widget
+ * @return id of the first cell
+ */
+static size_t price_cells(int x, int y)
+{
+    for (size_t i = 0; i < PRICE_WIDGETS; ++i) {
+        if (!price_pos[i].used) {
+            price_pos[i].used = true;
+            price_pos[i].x = x;
+            price_pos[i].y = y;
+        }
+        if (price_pos[i].x == x && price_pos[i].y == y) {
+            return CELL_PRICE + i * PRICE_CELLS;
         }
     }
+    return CELL_NONE;
+}
+
+/**
+ * Get indicator cell.
+ * @param base first cell of the indicator row
+ * @param index indicator index
+ * @return cell id
+ */
+static size_t indicator_cell(size_t base, int index)
+{
+    return index >= 0 && index < MAX_INDICATORS ? base + index
+                                                : static_cast<size_t>(CELL_NONE);
+}
+
+void display_set_backend(display_backend* backend)
+{
+    backend_override = backend;
 }
 
 extern "C" void display_init(void)
 {
-    lcd.init();
-    lcd.setRotation(1);
-    lcd.setColorDepth(lgfx::rgb888_3Byte);
-    lcd.setBrightness(20);
+    lcd = backend_override ? backend_override : display_default_backend();
+    lcd->init(display_format::id);
+    for (struct cell& c : cells) {
+        c = {};
+    }
+    draw_order = 0;
+    dirty.count = 0;
 }
 
+extern "C" void display_invalidate(void)
+{
+    // kept for composing the pixels around redrawn cells
+    for (struct cell& c : cells) {
+        c.stale = true;
+    }
+}
 
-extern "C" void display_static_elements(void)
+extern "C" void display_set_compose(bool enable)
+{
+    display_flush();
+    compose = enable;
+}
+
+extern "C" void display_flush(void)
+{
+    if (!dirty.count) {
+        return;
+    }
+    const uint64_t start = display_now_us();
+    const uint64_t bus_start = lcd->bus_time_us();
+    frame = {};
+    ++stats.flushes;
+    for (size_t i = 0; i < dirty.count; ++i) {
+        blit::flush_rect(&dirty.rects[i]);
+    }
+    blit::wait_bus();
+    stats.dirty_rects += dirty.count;
+    dirty.count = 0;
+    end_draw();
+
+    stats.frame_us = display_now_us() - start;
+    stats.render_us = frame.render_us;
+    stats.wait_us = frame.wait_us;
+    stats.bus_us = lcd->bus_time_us() - bus_start;
+}
+
+extern "C" void display_get_stats(struct display_stats* out)
+{
+    struct glyph_cache_stats cache;
+
+    glyph_cache_stats(&cache);
+    *out = stats;
+    out->cache_hits = cache.hits;
+    out->cache_misses = cache.misses;
+    out->cache_bytes = cache.used;
+}
+
+extern "C" void display_reset_stats(void)
 {
-    const uint32_t main_color = lcd.color888(100, 219, 255);
-    const uint32_t clr = lcd.color888(0xa0, 0x00, 0x00);
+    stats = {};
+    glyph_cache_reset_stats();
+}
+
 
-    lcd.startWrite();
-    //draw_image(get_image(image_celsius), 50, 250, clr);
-    //draw_image(get_image(image_percent), 155, 250, clr);
-    //draw_image(get_image(image_mm), 240, 250, clr);
+extern "C" void display_static_elements(void)
+{
+    constexpr uint32_t main_color = rgb(100, 219, 255);
 
-    fill(DISPLAY_WIDTH / 2 - 10, 50, 20, 20, main_color);
-    fill(DISPLAY_WIDTH / 2 - 10, 100, 20, 20, main_color);
-    fill(70, 210, 5, 5, main_color);   // dot between temperature full and remain
+    begin_draw();
+    fill(CELL_STATIC, DISPLAY_WIDTH / 2 - 10, 50, 20, 20, main_color);
+    fill(CELL_STATIC + 1, DISPLAY_WIDTH / 2 - 10, 100, 20, 20, main_color);
+    fill(CELL_STATIC + 2, 70, 210, 5, 5, main_color);   // dot between temperature full and remain
     //fill(70, 260, 5, 5, main_color);  // price full and remain.
-    lcd.endWrite();
+    end_draw();
 }
 // x  = 10, y = 230
 
-extern "C" void display_price(struct Price *price, int x, int y)
+extern "C" void display_price(const struct Price *price, int x, int y)
 {
     uint32_t color;
     unsigned long whole = (unsigned long) price->euros;
@@ -139,68 +735,75 @@ extern "C" void display_price(struct Price *price, int x, int y)
     switch (price->level)
     {
         case low:
-            color = lcd.color888(40, 255, 40);
+            color = rgb(40, 255, 40);
             break;
 
         case normal:
-            color = lcd.color888(100, 219, 255);
+            color = rgb(100, 219, 255);
             break;
 
         case high:
-            color = lcd.color888(255, 50, 50);
+            color = rgb(255, 50, 50);
             break;
 
         default:
-            color = lcd.color888(100, 219, 255);
+            color = rgb(100, 219, 255);
             break;
     }
 
-    lcd.startWrite();
-    draw_number(get_font(font28), x, y, color, whole, 2);
-    draw_number(get_font(font28), x + 70, y, color, fract, 2);
-    fill(x+60, y+30, 5, 5, color);
-    lcd.endWrite();
+    const size_t cell = price_cells(x, y);
+    const size_t none = CELL_NONE;
+    const size_t fract_cell = cell == none ? none : cell + NUMBER_DIGITS;
+    const size_t dot_cell = cell == none ? none : cell + 2 * NUMBER_DIGITS;
+
+    begin_draw();
+    draw_number(cell, get_font(font28), x, y, color, whole, 2);
+    draw_number(fract_cell, get_font(font28), x + 70, y, color, fract, 2);
+    fill(dot_cell, x+60, y+30, 5, 5, color);
+    end_draw();
 }
 
 extern "C" void display_temperature(float temperature)
 {
-    const uint32_t main_color = lcd.color888(100, 219, 255);
+    constexpr uint32_t main_color = rgb(100, 219, 255);
     unsigned long whole = (unsigned long) temperature;
     unsigned long fract = 100 * (temperature - whole);
 
-    lcd.startWrite();
-    draw_number(get_font(font28), 10, 170, main_color, whole, 2);
-    draw_number(get_font(font28), 80, 170, main_color, fract, 2);
-    lcd.endWrite();
+    begin_draw();
+    draw_number(CELL_TEMP_WHOLE, get_font(font28), 10, 170, main_color, whole, 2);
+    draw_number(CELL_TEMP_FRACT, get_font(font28), 80, 170, main_color, fract, 2);
+    end_draw();
 }   
 
 extern "C" void display_level(unsigned long level)
 {
-    const uint32_t main_color = lcd.color888(100, 219, 255);
+    constexpr uint32_t main_color = rgb(100, 219, 255);
 
-    lcd.startWrite();
-    draw_number(get_font(font28), 160, 170, main_color, level, 3);
-    lcd.endWrite();
+    begin_draw();
+    draw_number(CELL_LEVEL, get_font(font28), 160, 170, main_color, level, 3);
+    end_draw();
 }   
 
-extern "C" void display_time(struct ntpTime *time)
+extern "C" void display_time(const struct ntpTime *time)
 {
-    const uint32_t main_color = lcd.color888(100, 219, 255);
-
-    lcd.startWrite();
-    draw_number(get_font(font100), 10, 20, main_color, time->hours, 2);
-    draw_number(get_font(font100), 270, 20, main_color, time->minutes, 2);
-    //draw_number(get_font(font60), 350, 190, main_color, time->seconds, 2);
-    lcd.endWrite();
+    constexpr uint32_t main_color = rgb(100, 219, 255);
+
+    begin_draw();
+    draw_number(CELL_HOURS, get_font(font100), 10, 20, main_color, time->hours, 2);
+    draw_number(CELL_MINUTES, get_font(font100), 270, 20, main_color, time->minutes, 2);
+#if DISPLAY_SECONDS
+    draw_number(CELL_SECONDS, get_font(font60), 350, 190, main_color, time->seconds, 2);
+#endif
+    end_draw();
 }
 
-extern "C" void display_comm(struct commState *state)
+extern "C" void display_comm(const struct commState *state)
 {
     const struct image* iWifi = get_image(image_wifi);
     const struct image* iMqtt = get_image(image_mqtt);
     const struct image* iNtp = get_image(image_ntp);
-    const uint32_t on_color = lcd.color888(50, 255, 50);
-    const uint32_t off_color = lcd.color888(255, 50, 50);
+    constexpr uint32_t on_color = rgb(50, 255, 50);
+    constexpr uint32_t off_color = rgb(255, 50, 50);
     uint32_t wificolor, ntpcolor, mqttcolor;
 
     if (state->wifi)
@@ -218,11 +821,11 @@ extern "C" void display_comm(struct commState *state)
     else
         mqttcolor = off_color;
 
-    lcd.startWrite();
-    draw_image(iWifi, DISPLAY_WIDTH / 2 - 30, 0, wificolor);
-    draw_image(iNtp, DISPLAY_WIDTH / 2 - 5, 0, ntpcolor);
-    draw_image(iMqtt, DISPLAY_WIDTH / 2 + 20, 0, mqttcolor);
-    lcd.endWrite();
+    begin_draw();
+    draw_image(CELL_COMM, iWifi, DISPLAY_WIDTH / 2 - 30, 0, wificolor);
+    draw_image(CELL_COMM + 1, iNtp, DISPLAY_WIDTH / 2 - 5, 0, ntpcolor);
+    draw_image(CELL_COMM + 2, iMqtt, DISPLAY_WIDTH / 2 + 20, 0, mqttcolor);
+    end_draw();
 }
 
 
@@ -233,33 +836,33 @@ extern "C" void display_indicatoramount(int amount)
 
 extern "C" void display_icon(enum indicator state, enum image_type itype, int index)
 {
-    uint32_t color = lcd.color888(0, 0, 0);
+    uint32_t color = rgb(0, 0, 0);
 
     switch (state)
     {
         case INDICATOR_OFF:
-            color = lcd.color888(0, 0, 0);
+            color = rgb(0, 0, 0);
             break;
 
         case INDICATOR_ON:
-            color = lcd.color888(255, 255, 50);
+            color = rgb(255, 255, 50);
             break;
 
         case INDICATOR_CONNECTED:
-            color = lcd.color888(255, 50, 50);
+            color = rgb(255, 50, 50);
             break;
     }
     const struct image* iImage = get_image(itype);
-    lcd.startWrite();
-    draw_image(iImage, index * ind_spacing + 3, DISPLAY_HEIGHT - HEIGHT_INDICATOR, color);
-    lcd.endWrite();
+    begin_draw();
+    draw_image(indicator_cell(CELL_ICON, index), iImage, index * ind_spacing + 3, DISPLAY_HEIGHT - HEIGHT_INDICATOR, color);
+    end_draw();
 }
 
 extern "C" void display_indicator(enum indicator state, int index)
 {
-    const uint32_t connected_color  = lcd.color888(255, 50, 50);
-    const uint32_t off_color = lcd.color888(0, 0, 0);
-    const uint32_t on_color = lcd.color888(0xff, 0xff, 0x0b);
+    constexpr uint32_t connected_color = rgb(255, 50, 50);
+    constexpr uint32_t off_color = rgb(0, 0, 0);
+    constexpr uint32_t on_color = rgb(0xff, 0xff, 0x0b);
     uint32_t color = off_color;
     
     switch (state)
@@ -276,7 +879,7 @@ extern "C" void display_indicator(enum indicator state, int index)
             color = connected_color;
             break;
     }
-    lcd.startWrite();
-    fill(index * ind_spacing, DISPLAY_HEIGHT - HEIGHT_INDICATOR, ind_spacing, HEIGHT_INDICATOR, color);
-    lcd.endWrite();
+    begin_draw();
+    fill(indicator_cell(CELL_INDICATOR, index), index * ind_spacing, DISPLAY_HEIGHT - HEIGHT_INDICATOR, ind_spacing, HEIGHT_INDICATOR, color);
+    end_draw();
 }
\ No newline at end of file
@@ -11,6 +11,11 @@
 #define DISPLAY_WIDTH  480
 #define DISPLAY_HEIGHT 320
 
+// Show seconds of the clock, requires clock update once per second
+#ifndef DISPLAY_SECONDS
+#define DISPLAY_SECONDS 0
+#endif
+
 
 enum indicator {
     INDICATOR_OFF,
@@ -63,8 +68,19 @@ struct Heater {
 };
 
 
+/**
+ * Measurement on its way to the display. The times trace one update from
+ * the MQTT data event to the pixels; updates made on the device are
+ * received and parsed when they are created.
+ */
 struct measurement {
     enum meastype id;
+    int64_t received_us; // MQTT data event
+    int64_t parsed_us;   // fields extracted from the payload
+    int64_t queued_us;   // enqueue time
+    int64_t dequeued_us; // taken by the render task
+    int64_t rendered_us; // drawing started
+    int64_t flushed_us;  // frame flushed to the panel
     union {
         struct commState comm;
         struct Heater heater;
@@ -90,11 +106,64 @@ struct info {
     float pressure;
 };
 
+/**
+ * Rendering statistics.
+ */
+struct display_stats {
+    uint32_t calls;            // display_* calls
+    uint32_t transactions;     // bus transactions
+    uint32_t windows;          // address windows set
+    uint64_t pixels;           // pixels sent to the panel
+    uint64_t bus_bytes;        // bus traffic: window commands and pixel data
+    uint32_t cache_hits;       // symbols drawn from the glyph cache
+    uint32_t cache_misses;     // symbols decoded from the mask
+    uint32_t cache_bytes;      // glyph cache memory in use
+    uint32_t draws_performed;  // primitives drawn
+    uint32_t draws_skipped;    // primitives already shown on screen
+    uint32_t draws_transition; // symbols drawn as difference to previous one
+    uint32_t flushes;          // display_flush() calls with changes
+    uint32_t dirty_rects;      // merged regions sent by display_flush()
+    // timing of the last display_flush(), microseconds
+    uint32_t frame_us;         // whole flush
+    uint32_t render_us;        // CPU busy composing strips
+    uint32_t bus_us;           // bus busy transferring strips
+    uint32_t wait_us;          // CPU waiting for the bus
+};
+
 /**
  * Initialize LCD display.
  */
 void display_init(void);
 
+/**
+ * Enable or disable compose mode.
+ * In compose mode display_* calls only update retained screen content and
+ * display_flush() sends changed regions to the panel at once.
+ * @param enable true to enable compose mode
+ */
+void display_set_compose(bool enable);
+
+/**
+ * Send regions changed since the previous flush (compose mode only).
+ */
+void display_flush(void);
+
+/**
+ * Forget retained screen content, next draws repaint everything.
+ */
+void display_invalidate(void);
+
+/**
+ * Get rendering statistics.
+ * @param stats output statistics
+ */
+void display_get_stats(struct display_stats* stats);
+
+/**
+ * Reset rendering statistics.
+ */
+void display_reset_stats(void);
+
 /**
  * Redraw display.
  * @param info values to display
@@ -104,8 +173,8 @@ void display_indicator(enum indicator state, int index);
 void display_indicatoramount(int amount);
 void display_icon(enum indicator state, enum image_type itype, int index);
 void display_temperature(float temperature);
-void display_price(struct Price *price, int x, int y);
+void display_price(const struct Price *price, int x, int y);
 void display_level(unsigned long level);
-void display_time(struct ntpTime *time);
-void display_comm(struct commState *state);
+void display_time(const struct ntpTime *time);
+void display_comm(const struct commState *state);
 void display_static_elements(void);
\ No newline at end of file
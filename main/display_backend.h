@@ -0,0 +1,127 @@
+// SPDX-License-Identifier: MIT
+// Display backend interface.
+
+#pragma once
+
+#include "display_format.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Pixel sink used by the renderer in display.cpp.
+ * All drawing logic lives in the renderer, a backend only moves pixels to
+ * the panel (LovyanGFX on the board, memory or nothing on the host).
+ */
+class display_backend {
+public:
+    virtual ~display_backend() = default;
+
+    /**
+     * Initialize output device.
+     * @param format pixel format of all colors passed to the backend
+     */
+    virtual void init(enum pixel_format_id format) = 0;
+
+    /**
+     * Open bus transaction.
+     */
+    virtual void start_write() = 0;
+
+    /**
+     * Close bus transaction.
+     */
+    virtual void end_write() = 0;
+
+    /**
+     * Set address window, following pixels fill it row by row.
+     * @param x,y coordinates of the left top corner
+     * @param width,height size of the window
+     */
+    virtual void set_window(size_t x, size_t y, size_t width,
+                            size_t height) = 0;
+
+    /**
+     * Write run of same colored pixels into the current window.
+     * @param color color in the pixel format
+     * @param length number of pixels
+     */
+    virtual void write_color(uint32_t color, size_t length) = 0;
+
+    /**
+     * Write pixels into the current window.
+     * @param data pixels in the pixel format, in bus order (to_bus())
+     * @param length number of pixels
+     */
+    virtual void push_pixels(const void* data, size_t length) = 0;
+
+    /**
+     * Start writing pixels into the current window without waiting for the
+     * transfer to complete, data must stay unchanged until wait().
+     * @param data pixels in the pixel format, in bus order (to_bus())
+     * @param length number of pixels
+     */
+    virtual void push_pixels_async(const void* data, size_t length)
+    {
+        push_pixels(data, length);
+    }
+
+    /**
+     * Wait for completion of asynchronous transfers.
+     */
+    virtual void wait() {}
+
+    /**
+     * Get total time the bus spent on push_pixels transfers.
+     * @return time in microseconds, 0 if not measured
+     */
+    virtual uint64_t bus_time_us() const { return 0; }
+
+    /**
+     * Fill rectangle with specified color.
+     * @param x,y coordinates of the left top corner
+     * @param width,height size of the rectangle
+     * @param color color in the pixel format
+     */
+    virtual void fill_rect(size_t x, size_t y, size_t width, size_t height,
+                           uint32_t color) = 0;
+};
+
+/**
+ * Get backend used by display_init() on this platform.
+ * @return backend instance
+ */
+display_backend* display_default_backend(void);
+
+/**
+ * Get monotonic time.
+ * @return time in microseconds
+ */
+uint64_t display_now_us(void);
+
+/**
+ * Replace active backend, must be called before display_init().
+ * @param backend backend instance, nullptr restores the default one
+ */
+void display_set_backend(display_backend* backend);
+
+#ifndef ESP_PLATFORM
+/**
+ * Host backends: in-memory framebuffer and null sink.
+ */
+display_backend* display_framebuffer_backend(void);
+display_backend* display_null_backend(void);
+
+/**
+ * Simulate DMA transfers in the host framebuffer: asynchronous pushes are
+ * written by a worker thread that holds the bus for the modelled time.
+ * @param bus_hz modelled bus clock, 0 for synchronous transfers
+ */
+void display_framebuffer_dma(uint32_t bus_hz);
+
+/**
+ * Get host framebuffer content.
+ * @return DISPLAY_WIDTH * DISPLAY_HEIGHT rgb888 pixels, row-major
+ */
+const uint32_t* display_framebuffer(void);
+#endif
@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: MIT
+// Pixel formats of the display bus.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Pixel format used by the renderer: rgb565 or rgb888
+#ifndef DISPLAY_PIXEL_FORMAT
+#define DISPLAY_PIXEL_FORMAT rgb565
+#endif
+
+enum pixel_format_id {
+    PIXEL_RGB565,
+    PIXEL_RGB888,
+};
+
+/**
+ * 16-bit color, 2 bytes per pixel on the bus.
+ */
+struct rgb565 {
+    using pixel = uint16_t;
+    static constexpr enum pixel_format_id id = PIXEL_RGB565;
+    static constexpr size_t bus_bytes = 2;
+    static constexpr const char* name = "rgb565";
+
+    static constexpr pixel color(uint8_t r, uint8_t g, uint8_t b)
+    {
+        return ((r & 0xf8) << 8) | ((g & 0xfc) << 3) | (b >> 3);
+    }
+
+    // Pixel in memory order of the bus, high byte first
+    static constexpr pixel to_bus(pixel p)
+    {
+        return static_cast<pixel>((p >> 8) | (p << 8));
+    }
+
+    static constexpr pixel from_bus(pixel p) { return to_bus(p); }
+
+    static constexpr uint32_t to_rgb888(pixel p)
+    {
+        const uint32_t r = (p >> 11) & 0x1f;
+        const uint32_t g = (p >> 5) & 0x3f;
+        const uint32_t b = p & 0x1f;
+        return (((r << 3) | (r >> 2)) << 16) | (((g << 2) | (g >> 4)) << 8) |
+            ((b << 3) | (b >> 2));
+    }
+};
+
+/**
+ * 24-bit color, 3 bytes per pixel on the bus.
+ */
+struct rgb888 {
+    using pixel = uint32_t;
+    static constexpr enum pixel_format_id id = PIXEL_RGB888;
+    static constexpr size_t bus_bytes = 3;
+    static constexpr const char* name = "rgb888";
+
+    static constexpr pixel color(uint8_t r, uint8_t g, uint8_t b)
+    {
+        return (static_cast<uint32_t>(r) << 16) |
+            (static_cast<uint32_t>(g) << 8) | b;
+    }
+
+    // kept as uint32_t, the backend sends the color components
+    static constexpr pixel to_bus(pixel p) { return p; }
+
+    static constexpr pixel from_bus(pixel p) { return p; }
+
+    static constexpr uint32_t to_rgb888(pixel p) { return p; }
+};
+
+using display_format = DISPLAY_PIXEL_FORMAT;
@@ -0,0 +1,127 @@
+// SPDX-License-Identifier: MIT
+// LovyanGFX display backend.
+
+extern "C" {
+#include "display.h"
+}
+
+#include "display_backend.h"
+
+#define LGFX_WT32_SC01
+
+#include <LGFX_AUTODETECT.hpp>
+#include <esp_timer.h>
+
+namespace {
+
+class lgfx_backend : public display_backend {
+public:
+    void init(enum pixel_format_id format) override
+    {
+        rgb565 = format == PIXEL_RGB565;
+        lcd.init();
+        lcd.setRotation(1);
+        lcd.setColorDepth(rgb565 ? lgfx::rgb565_2Byte : lgfx::rgb888_3Byte);
+        lcd.setBrightness(20);
+        lcd.initDMA();
+    }
+
+    void start_write() override { lcd.startWrite(); }
+
+    void end_write() override { lcd.endWrite(); }
+
+    void set_window(size_t x, size_t y, size_t width, size_t height) override
+    {
+        wait();
+        lcd.setAddrWindow(x, y, width, height);
+    }
+
+    // LovyanGFX takes uint16_t colors as rgb565 and uint32_t as rgb888
+    void write_color(uint32_t color, size_t length) override
+    {
+        if (rgb565) {
+            lcd.writeColor(static_cast<uint16_t>(color), length);
+        } else {
+            lcd.writeColor(color, length);
+        }
+    }
+
+    void push_pixels(const void* data, size_t length) override
+    {
+        const uint64_t start = esp_timer_get_time();
+        if (rgb565) {
+            // pixels are already in bus order, no swap
+            lcd.pushPixels(static_cast<const uint16_t*>(data), length, false);
+            bus_time += esp_timer_get_time() - start;
+            return;
+        }
+        // rgb888 pixels are kept as uint32_t, send them as runs
+        const uint32_t* pixels = static_cast<const uint32_t*>(data);
+        size_t begin = 0;
+        for (size_t i = 1; i <= length; ++i) {
+            if (i == length || pixels[i] != pixels[begin]) {
+                lcd.writeColor(pixels[begin], i - begin);
+                begin = i;
+            }
+        }
+        bus_time += esp_timer_get_time() - start;
+    }
+
+    void push_pixels_async(const void* data, size_t length) override
+    {
+        if (rgb565) {
+            dma_start = esp_timer_get_time();
+            // already in bus order, the default swap would reverse the
+            // bytes again
+            lcd.pushPixelsDMA(static_cast<const uint16_t*>(data), length, false);
+        } else {
+            push_pixels(data, length);
+        }
+    }
+
+    // DMA completion is not signalled, transfer is considered done when
+    // waitDMA() returns
+    void wait() override
+    {
+        if (dma_start) {
+            lcd.waitDMA();
+            bus_time += esp_timer_get_time() - dma_start;
+            dma_start = 0;
+        }
+    }
+
+    uint64_t bus_time_us() const override { return bus_time; }
+
+    void fill_rect(size_t x, size_t y, size_t width, size_t height,
+                   uint32_t color) override
+    {
+        if (rgb565) {
+            lcd.writeFillRect(x, y, width, height,
+                              static_cast<uint16_t>(color));
+        } else {
+            lcd.writeFillRect(x, y, width, height, color);
+        }
+    }
+
+private:
+    // LCD handle
+    LGFX lcd;
+    bool rgb565;
+    // start of the pending DMA transfer, 0 if none
+    uint64_t dma_start;
+    uint64_t bus_time;
+};
+
+lgfx_backend lgfx;
+
+} // namespace
+
+uint64_t display_now_us(void)
+{
+    return esp_timer_get_time();
+}
+
+display_backend* display_default_backend(void)
+{
+    return &lgfx;
+}
@@ -0,0 +1,155 @@
+// SPDX-License-Identifier: MIT
+// Cache of decoded font symbols and images.
+
+#include "glyph_cache.h"
+
+#include <string.h>
+
+// Cached symbol
+struct entry {
+    struct mask_area area;
+    size_t start;      // first run in the arena
+    size_t count;      // number of runs
+    uint32_t last_use; // LRU stamp
+};
+
+static uint16_t arena[DISPLAY_GLYPH_CACHE_SIZE / sizeof(uint16_t)];
+static struct entry entries[DISPLAY_GLYPH_CACHE_ENTRIES];
+static size_t num_entries;
+static size_t arena_used;
+static uint32_t use_clock;
+static struct glyph_cache_stats stats;
+
+/**
+ * Decode mask area into runs.
+ * @param area mask area to decode
+ * @param runs output buffer, nullptr to count runs only
+ * @return number of runs
+ */
+static size_t decode(const struct mask_area* area, uint16_t* runs)
+{
+    size_t count = 0;
+    bool run_bit = false;
+    size_t run_length = 0;
+
+    for (size_t y = 0; y < area->height; ++y) {
+        for (size_t x = 0; x < area->width; ++x) {
+            const bool bit = mask_bit(area, x, y);
+            if (bit != run_bit || run_length == UINT16_MAX) {
+                if (runs) {
+                    runs[count] = run_length;
+                }
+                ++count;
+                if (bit == run_bit) {
+                    // split too long run with an empty one
+                    if (runs) {
+                        runs[count] = 0;
+                    }
+                    ++count;
+                }
+                run_bit = bit;
+                run_length = 0;
+            }
+            ++run_length;
+        }
+    }
+    if (runs) {
+        runs[count] = run_length;
+    }
+    return count + 1;
+}
+
+/**
+ * Remove entry and compact the arena.
+ * @param index index of the entry to remove
+ */
+static void evict(size_t index)
+{
+    const struct entry victim = entries[index];
+    const size_t tail = victim.start + victim.count;
+
+    memmove(&arena[victim.start], &arena[tail],
+            (arena_used - tail) * sizeof(uint16_t));
+    arena_used -= victim.count;
+
+    for (size_t i = 0; i < num_entries; ++i) {
+        if (entries[i].start > victim.start) {
+            entries[i].start -= victim.count;
+        }
+    }
+    entries[index] = entries[--num_entries];
+    ++stats.evictions;
+}
+
+/**
+ * Find least recently used entry.
+ * @return index of the entry
+ */
+static size_t find_lru(void)
+{
+    size_t lru = 0;
+    for (size_t i = 1; i < num_entries; ++i) {
+        if (entries[i].last_use < entries[lru].last_use) {
+            lru = i;
+        }
+    }
+    return lru;
+}
+
+static bool same_area(const struct mask_area* a, const struct mask_area* b)
+{
+    return a->mask == b->mask && a->offset == b->offset &&
+        a->stride == b->stride && a->width == b->width &&
+        a->height == b->height;
+}
+
+bool glyph_cache_get(const struct mask_area* area, struct mask_runs* runs)
+{
+    const size_t capacity = sizeof(arena) / sizeof(arena[0]);
+
+    for (size_t i = 0; i < num_entries; ++i) {
+        struct entry* e = &entries[i];
+        if (same_area(&e->area, area)) {
+            ++stats.hits;
+            e->last_use = ++use_clock;
+            runs->runs = &arena[e->start];
+            runs->count = e->count;
+            return true;
+        }
+    }
+
+    const size_t count = decode(area, nullptr);
+    if (count > capacity) {
+        ++stats.bypass;
+        return false;
+    }
+
+    ++stats.misses;
+    while (num_entries == DISPLAY_GLYPH_CACHE_ENTRIES ||
+           arena_used + count > capacity) {
+        evict(find_lru());
+    }
+
+    struct entry* e = &entries[num_entries++];
+    e->area = *area;
+    e->start = arena_used;
+    e->count = count;
+    e->last_use = ++use_clock;
+    decode(area, &arena[e->start]);
+    arena_used += count;
+
+    runs->runs = &arena[e->start];
+    runs->count = count;
+    return true;
+}
+
+void glyph_cache_stats(struct glyph_cache_stats* out)
+{
+    *out = stats;
+    out->used = arena_used * sizeof(uint16_t);
+}
+
+void glyph_cache_reset_stats(void)
+{
+    stats = {};
+}
@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: MIT
+// Cache of decoded font symbols and images.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Cache size in bytes, allocated statically in internal RAM
+#ifndef DISPLAY_GLYPH_CACHE_SIZE
+#define DISPLAY_GLYPH_CACHE_SIZE (24 * 1024)
+#endif
+
+// Max number of cached symbols
+#ifndef DISPLAY_GLYPH_CACHE_ENTRIES
+#define DISPLAY_GLYPH_CACHE_ENTRIES 40
+#endif
+
+/**
+ * Area of a 1-bpp mask: a whole image or a single font symbol.
+ */
+struct mask_area {
+    const uint8_t* mask; // mask bits
+    size_t stride;       // mask row size in bits
+    size_t offset;       // bit offset of the left top corner
+    size_t width;
+    size_t height;
+};
+
+/**
+ * Decoded mask: pixel runs of the whole area in row-major order, joined
+ * across row boundaries. Runs alternate background and foreground,
+ * starting with background; zero-length runs are allowed.
+ */
+struct mask_runs {
+    const uint16_t* runs;
+    size_t count;
+};
+
+/**
+ * Cache statistics.
+ */
+struct glyph_cache_stats {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+    uint32_t bypass; // areas too large to be cached
+    size_t used;     // bytes in use
+};
+
+/**
+ * Get decoded mask, decode and cache it on miss.
+ * @param area mask area to look up
+ * @param runs output runs, valid until the next call
+ * @return false if the area does not fit into the cache
+ */
+bool glyph_cache_get(const struct mask_area* area, struct mask_runs* runs);
+
+/**
+ * Get cache statistics.
+ * @param stats output statistics
+ */
+void glyph_cache_stats(struct glyph_cache_stats* stats);
+
+/**
+ * Reset cache statistics, cached content is kept.
+ */
+void glyph_cache_reset_stats(void);
+
+/**
+ * Get mask bit value.
+ * @param area mask area
+ * @param x,y coordinates inside the area
+ * @return mask bit value
+ */
+static inline bool mask_bit(const struct mask_area* area, size_t x, size_t y)
+{
+    const size_t bit_index = area->offset + y * area->stride + x;
+    return (area->mask[bit_index / 8] >> (bit_index % 8)) & 1;
+}
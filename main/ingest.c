@@ -0,0 +1,503 @@
+// SPDX-License-Identifier: MIT
+// MQTT message ingestion: topic and JSON field to measurement mapping.
+
+#include "ingest.h"
+
+#include "cJSON.h"
+#include "dedup.h"
+#include "json_arena.h"
+#include "json_extract.h"
+#include "topic_router.h"
+
+#include <esp_log.h>
+#include <string.h>
+#include <time.h>
+
+// Key index of unused fields
+#define NO_KEY 0xff
+
+// Number of measurement types
+#define MEASTYPES (AVGPRICE + 1)
+
+// Binding with key names resolved to indices of the extracted values
+struct compiled {
+    uint8_t key;
+    uint8_t aux;
+    uint8_t match[BINDING_MATCHES];
+};
+
+// Bindings of one topic filter
+struct route {
+    uint16_t first; // first index in the order table
+    uint16_t count;
+    uint32_t keys;  // mask of the keys used by the bindings
+    bool dedup;     // repeated payloads can be skipped
+    bool strict;    // skipped only on equal fields, never on a payload hash
+};
+
+static const char* log_tag = "ingest";
+
+static ingest_sink sink;
+static ingest_clock now_us;
+static struct topic_router router;
+
+// distinct keys of all bindings, extracted from every routed payload
+static const char* keys[INGEST_KEYS];
+static size_t num_keys;
+
+static struct compiled compiled[INGEST_BINDINGS];
+static struct route routes[INGEST_BINDINGS];
+static uint16_t order[INGEST_BINDINGS]; // binding indices grouped by route
+static size_t num_routes;
+
+// group members state
+static bool active[INGEST_BINDINGS];
+static uint16_t group_active[MEASTYPES];
+
+static struct ingest_stats stats;
+
+/**
+ * Get index of a key, add it if not yet known.
+ * @return key index, NO_KEY for NULL key or if the key table is full
+ */
+static uint8_t key_index(const char* key)
+{
+    if (!key) {
+        return NO_KEY;
+    }
+    for (size_t i = 0; i < num_keys; ++i) {
+        if (!strcmp(keys[i], key)) {
+            return i;
+        }
+    }
+    if (num_keys == INGEST_KEYS) {
+        return NO_KEY;
+    }
+    keys[num_keys] = key;
+    return num_keys++;
+}
+
+static bool valid_binding(const struct binding* b)
+{
+    switch (b->transform) {
+        case TRANSFORM_VALUE:
+            return b->kind == FIELD_NUMBER;
+        case TRANSFORM_PRICE:
+        case TRANSFORM_DAY_PRICE:
+            return b->kind == FIELD_NUMBER && b->aux;
+        case TRANSFORM_SWITCH:
+        case TRANSFORM_GROUP:
+            return b->kind == FIELD_BOOL;
+        case TRANSFORM_LOAD:
+            return b->kind == FIELD_BOOL && b->aux;
+    }
+    return false;
+}
+
+bool ingest_init(ingest_sink consumer, ingest_clock clock)
+{
+    uint16_t route_of[INGEST_BINDINGS];
+
+    sink = consumer;
+    now_us = clock;
+    json_arena_init();
+    topic_router_init(&router);
+    num_keys = 0;
+    num_routes = 0;
+
+    if (num_bindings > INGEST_BINDINGS) {
+        ESP_LOGE(log_tag, "Too many bindings: %u", (unsigned)num_bindings);
+        return false;
+    }
+
+    for (size_t i = 0; i < num_bindings; ++i) {
+        const struct binding* b = &bindings[i];
+        struct compiled* c = &compiled[i];
+
+        c->key = key_index(b->key);
+        c->aux = key_index(b->aux);
+        for (size_t m = 0; m < BINDING_MATCHES; ++m) {
+            c->match[m] = key_index(b->match[m].key);
+        }
+        if (!valid_binding(b) || c->key == NO_KEY ||
+            (b->aux && c->aux == NO_KEY)) {
+            ESP_LOGE(log_tag, "Invalid binding %s %s", b->topic, b->key);
+            return false;
+        }
+
+        // bindings with the same filter share the route
+        size_t r = 0;
+        while (r < i && strcmp(bindings[r].topic, b->topic)) {
+            ++r;
+        }
+        if (r < i) {
+            route_of[i] = route_of[r];
+        } else {
+            route_of[i] = num_routes++;
+            if (!topic_router_add(&router, b->topic, route_of[i])) {
+                ESP_LOGE(log_tag, "Unable to route %s", b->topic);
+                return false;
+            }
+        }
+    }
+
+    // group binding indices by route
+    memset(routes, 0, sizeof(routes));
+    for (size_t i = 0; i < num_bindings; ++i) {
+        ++routes[route_of[i]].count;
+    }
+    for (size_t r = 1; r < num_routes; ++r) {
+        routes[r].first = routes[r - 1].first + routes[r - 1].count;
+    }
+    uint16_t fill[INGEST_BINDINGS] = { 0 };
+    for (size_t r = 0; r < num_routes; ++r) {
+        routes[r].dedup = true;
+    }
+    for (size_t i = 0; i < num_bindings; ++i) {
+        const struct compiled* c = &compiled[i];
+        struct route* r = &routes[route_of[i]];
+        order[r->first + fill[route_of[i]]++] = i;
+
+        r->keys |= 1u << c->key;
+        if (c->aux != NO_KEY) {
+            r->keys |= 1u << c->aux;
+        }
+        for (size_t m = 0; m < BINDING_MATCHES; ++m) {
+            if (c->match[m] != NO_KEY) {
+                r->keys |= 1u << c->match[m];
+            }
+        }
+        // result depends on the current day, not only on the payload
+        if (bindings[i].transform == TRANSFORM_DAY_PRICE) {
+            r->dedup = false;
+        }
+        // a lost door or leak transition is not corrected by the next
+        // message: only the route of an exact filter confirms the topic,
+        // hash matches are not trusted
+        if (bindings[i].transform == TRANSFORM_GROUP) {
+            if (strpbrk(bindings[i].topic, "+#")) {
+                r->dedup = false;
+            } else {
+                r->strict = true;
+            }
+        }
+    }
+    dedup_reset();
+
+    ESP_LOGI(log_tag, "%u bindings, %u routes, %u keys",
+             (unsigned)num_bindings, (unsigned)num_routes, (unsigned)num_keys);
+    return true;
+}
+
+static int today(void)
+{
+    time_t now_utc;
+    struct tm now_local;
+
+    time(&now_utc);
+    localtime_r(&now_utc, &now_local);
+    return now_local.tm_wday;
+}
+
+static bool matches(const struct binding* b, const struct compiled* c,
+                    const struct json_value* values)
+{
+    for (size_t m = 0; m < BINDING_MATCHES; ++m) {
+        const struct field_match* match = &b->match[m];
+        if (!match->key) {
+            continue;
+        }
+        const struct json_value* v = &values[c->match[m]];
+        if (match->string ? !json_value_equals(v, match->string)
+                          : v->type != JSON_NUMBER ||
+                              json_value_int(v) != match->number) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void emit_indicator(enum meastype target, enum indicator state,
+                           const struct measurement* times)
+{
+    struct measurement meas = *times;
+    meas.id = target;
+    meas.data.indic = state;
+    ++stats.emitted;
+    sink(&meas);
+}
+
+/**
+ * Apply binding to the extracted values.
+ * @param times receive and parse time of the payload
+ * @return true if a measurement was sent
+ */
+static bool apply(size_t index, const struct json_value* values,
+                  const struct measurement* times)
+{
+    const struct binding* b = &bindings[index];
+    const struct compiled* c = &compiled[index];
+    const struct json_value* v = &values[c->key];
+    const struct json_value* aux = c->aux == NO_KEY ? NULL : &values[c->aux];
+    struct measurement meas = *times;
+
+    if (!matches(b, c, values)) {
+        return false;
+    }
+    if (b->kind == FIELD_NUMBER ? v->type != JSON_NUMBER
+                                : v->type != JSON_TRUE &&
+                                    v->type != JSON_FALSE) {
+        ESP_LOGI(log_tag, "%s has unexpected type", b->key);
+        return false;
+    }
+    const bool on = v->type == JSON_TRUE;
+
+    meas.id = b->target;
+    switch (b->transform) {
+        case TRANSFORM_VALUE:
+            if (b->target == LEVEL) {
+                meas.data.heater.level = json_value_int(v);
+            } else {
+                meas.data.heater.temperature = v->number;
+            }
+            break;
+
+        case TRANSFORM_PRICE:
+            meas.data.price.euros = v->number;
+            if (json_value_equals(aux, "low")) {
+                meas.data.price.level = low;
+            } else if (json_value_equals(aux, "high")) {
+                meas.data.price.level = high;
+            } else {
+                meas.data.price.level = normal;
+            }
+            break;
+
+        case TRANSFORM_DAY_PRICE:
+            if (aux->type != JSON_NUMBER || json_value_int(aux) != today()) {
+                return false;
+            }
+            meas.data.price.euros = v->number;
+            meas.data.price.level = normal;
+            break;
+
+        case TRANSFORM_SWITCH:
+            meas.data.indic = on ? INDICATOR_CONNECTED : INDICATOR_OFF;
+            break;
+
+        case TRANSFORM_LOAD:
+            if (!on) {
+                meas.data.indic = INDICATOR_OFF;
+            } else if (aux->type == JSON_NUMBER) {
+                meas.data.indic = aux->number > b->threshold
+                    ? INDICATOR_CONNECTED
+                    : INDICATOR_ON;
+            } else {
+                return false;
+            }
+            break;
+
+        case TRANSFORM_GROUP:
+            if (active[index] != (on != b->invert)) {
+                active[index] = !active[index];
+                group_active[b->target] += active[index] ? 1 : -1;
+            }
+            emit_indicator(b->target,
+                           group_active[b->target] ? INDICATOR_ON
+                                                   : INDICATOR_OFF,
+                           times);
+            return true;
+    }
+
+    ++stats.emitted;
+    sink(&meas);
+    return true;
+}
+
+/**
+ * Pack values of the keys used by a route for an exact comparison.
+ * @param out output buffer
+ * @param size size of out
+ * @return packed length, 0 if the values do not fit
+ */
+static size_t fields_pack(const struct json_value* values, uint32_t keys,
+                          uint8_t* out, size_t size)
+{
+    size_t length = 0;
+    for (size_t i = 0; i < num_keys; ++i) {
+        if (!(keys & (1u << i))) {
+            continue;
+        }
+        const struct json_value* v = &values[i];
+        size_t need = 1;
+        if (v->type == JSON_NUMBER) {
+            need += sizeof(v->number);
+        } else if (v->type == JSON_STRING) {
+            if (v->length > UINT8_MAX) {
+                return 0;
+            }
+            need += 1 + v->length;
+        }
+        if (length + need > size) {
+            return 0;
+        }
+        out[length++] = v->type;
+        if (v->type == JSON_NUMBER) {
+            memcpy(&out[length], &v->number, sizeof(v->number));
+        } else if (v->type == JSON_STRING) {
+            out[length] = v->length;
+            memcpy(&out[length + 1], v->string, v->length);
+        }
+        length += need - 1;
+    }
+    return length;
+}
+
+/**
+ * Handle complete payload.
+ * @param payload payload with route id as tag
+ */
+static void ingest_payload(const struct mqtt_payload* payload)
+{
+    struct json_value values[INGEST_KEYS];
+    const struct route* r = &routes[payload->tag];
+    struct dedup_entry* seen = NULL;
+    cJSON* root = NULL;
+    bool fallback = false;
+
+    // byte-identical payload on the same topic is not parsed again
+    if (r->dedup) {
+        const uint32_t topic = dedup_hash(DEDUP_HASH_INIT, payload->topic,
+                                          payload->topic_len);
+        seen = dedup_entry(topic, payload->tag);
+    }
+    if (seen && !r->strict) {
+        const uint32_t hash =
+            dedup_hash(DEDUP_HASH_INIT, payload->data, payload->length);
+        if (seen->has_payload && seen->payload == hash) {
+            ++stats.duplicates;
+            return;
+        }
+        // recorded before the parse: a payload that fails to parse is not
+        // parsed again either
+        seen->payload = hash;
+        seen->has_payload = true;
+    }
+
+    // fields are read straight from the payload, the cJSON tree is built
+    // only for escaped strings, unescaped in place in the payload buffer
+    enum json_extract_result res =
+        json_extract(payload->data, payload->length, keys, values, num_keys);
+    if (res == JSON_EXTRACT_FALLBACK) {
+        // a failed parse leaves its nodes in the arena too
+        fallback = true;
+        root = cJSON_ParseInSitu(payload->data, payload->length);
+        if (root) {
+            json_extract_tree(root, keys, values, num_keys);
+            res = JSON_EXTRACT_OK;
+        }
+    }
+
+    if (res == JSON_EXTRACT_OK) {
+        bool routed = false;
+        ++stats.parsed;
+
+        // changes in other fields (battery, linkquality) are not queued
+        uint8_t fields[DEDUP_FIELDS_SIZE];
+        const size_t length =
+            seen ? fields_pack(values, r->keys, fields, sizeof(fields)) : 0;
+        if (length && seen->has_fields && seen->fields_len == length &&
+            !memcmp(seen->fields, fields, length)) {
+            ++stats.unchanged;
+            goto done;
+        }
+        if (seen) {
+            memcpy(seen->fields, fields, length);
+            seen->fields_len = length;
+            seen->has_fields = length != 0;
+        }
+
+        const struct measurement times = {
+            .received_us = payload->time_us,
+            .parsed_us = now_us(),
+        };
+        for (size_t i = 0; i < r->count; ++i) {
+            routed |= apply(order[r->first + i], values, &times);
+        }
+        if (routed) {
+            ++stats.routed;
+            ESP_LOGD(log_tag, "%.*s changed", (int)payload->topic_len,
+                     payload->topic);
+        }
+    }
+
+done:
+    if (root) {
+        cJSON_DeleteInSitu(root);
+    }
+    if (fallback) {
+        json_arena_reset();
+    }
+}
+
+void ingest_fragment(const struct mqtt_fragment* frag)
+{
+    struct mqtt_payload payload;
+
+    // route on topic first, unrelated payloads are not parsed; topic is
+    // present in the first fragment only
+    int route = TOPIC_ROUTE_NONE;
+    if (frag->offset == 0) {
+        ++stats.received;
+        if (frag->topic) {
+            route = topic_router_match(&router, frag->topic, frag->topic_len);
+        }
+        if (route == TOPIC_ROUTE_NONE) {
+            ++stats.ignored;
+        }
+    }
+
+    // collect fragments of payloads larger than the MQTT buffer
+    if (reassembly_feed(frag, route, &payload) == REASSEMBLY_COMPLETE) {
+        ingest_payload(&payload);
+    }
+}
+
+size_t ingest_topics(const char** filters, size_t max)
+{
+    size_t count = 0;
+
+    for (size_t r = 0; r < num_routes; ++r) {
+        const char* filter = ingest_route_topic(r);
+        bool covered = false;
+        for (size_t other = 0; other < num_routes && !covered; ++other) {
+            const char* wider = ingest_route_topic(other);
+            covered = other != r && topic_filter_covers(wider, filter);
+        }
+        if (!covered) {
+            if (count < max) {
+                filters[count] = filter;
+            }
+            ++count;
+        }
+    }
+    return count;
+}
+
+int ingest_route(const char* topic, size_t length)
+{
+    return topic_router_match(&router, topic, length);
+}
+
+const char* ingest_route_topic(int route)
+{
+    if (route < 0 || (size_t)route >= num_routes) {
+        return NULL;
+    }
+    return bindings[order[routes[route].first]].topic;
+}
+
+void ingest_stats(struct ingest_stats* out)
+{
+    *out = stats;
+}
@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: MIT
+// MQTT message ingestion: topic and JSON field to measurement mapping.
+
+#pragma once
+
+#include "display.h"
+#include "reassembly.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Max number of bindings
+#ifndef INGEST_BINDINGS
+#define INGEST_BINDINGS 256
+#endif
+
+// Max number of distinct JSON keys used by the bindings, at most 32 as the
+// keys of a route are kept in a bit mask
+#ifndef INGEST_KEYS
+#define INGEST_KEYS 32
+#endif
+
+// Number of field conditions of a binding
+#define BINDING_MATCHES 2
+
+// Value kind of a JSON field
+enum field_kind {
+    FIELD_NUMBER,
+    FIELD_BOOL,
+};
+
+// Conversion of a field value into a measurement
+enum transform {
+    TRANSFORM_VALUE,     // number as is: level, temperature
+    TRANSFORM_PRICE,     // number, aux string "low"/"high" sets the level
+    TRANSFORM_DAY_PRICE, // number, used if aux weekday number is today
+    TRANSFORM_SWITCH,    // bool: indicator off or connected
+    TRANSFORM_LOAD,      // bool: off, on, connected if aux number is above
+                         // threshold
+    TRANSFORM_GROUP,     // bool: sets member of a group, indicator is on if
+                         // any member of the target group is active
+};
+
+/**
+ * Equality condition on a payload field.
+ */
+struct field_match {
+    const char* key;    // NULL if unused
+    const char* string; // expected string, NULL to compare number
+    int number;         // expected number
+};
+
+/**
+ * Mapping of one field of a topic to a measurement.
+ */
+struct binding {
+    const char* topic; // topic filter, MQTT wildcards allowed
+    struct field_match match[BINDING_MATCHES];
+    const char* key; // value field
+    enum field_kind kind;
+    enum transform transform;
+    const char* aux; // second field used by the transform
+    float threshold;
+    bool invert; // group member is active when the value is false
+    enum meastype target;
+};
+
+/**
+ * Binding table, defined in bindings.c.
+ */
+extern const struct binding bindings[];
+extern const size_t num_bindings;
+
+/**
+ * Measurement consumer.
+ * @param meas measurement to send to the renderer
+ */
+typedef void (*ingest_sink)(struct measurement* meas);
+
+/**
+ * Monotonic time source for the measurement times.
+ * @return time in microseconds
+ */
+typedef int64_t (*ingest_clock)(void);
+
+/**
+ * Ingestion statistics.
+ */
+struct ingest_stats {
+    uint32_t received;   // payloads, counted on the first fragment
+    uint32_t ignored;    // topic not routed, payload not parsed
+    uint32_t duplicates; // identical to the previous payload, not parsed
+    uint32_t parsed;     // payloads parsed
+    uint32_t unchanged;  // used fields unchanged, nothing queued
+    uint32_t routed;     // payloads matched by a binding
+    uint32_t emitted;    // measurements sent to the sink
+};
+
+/**
+ * Compile the binding table.
+ * @param sink measurement consumer
+ * @param clock time source of the parse time
+ * @return false if a binding is invalid or a limit is exceeded
+ */
+bool ingest_init(ingest_sink sink, ingest_clock clock);
+
+/**
+ * Handle MQTT data event.
+ * @param frag data event, payload buffer is modified
+ */
+void ingest_fragment(const struct mqtt_fragment* frag);
+
+/**
+ * Get topic filters of the bindings to subscribe. Filters covered by a
+ * wider filter are left out.
+ * @param filters output filters
+ * @param max size of filters, INGEST_BINDINGS always fits
+ * @return number of filters, more than max if some were left out
+ */
+size_t ingest_topics(const char** filters, size_t max);
+
+/**
+ * Find route of a topic.
+ * @param topic topic name, does not need to be NUL-terminated
+ * @param length topic length
+ * @return route index, negative if no binding uses the topic
+ */
+int ingest_route(const char* topic, size_t length);
+
+/**
+ * Get topic filter of a route.
+ * @param route route index
+ * @return topic filter, NULL if there is no such route
+ */
+const char* ingest_route_topic(int route);
+
+/**
+ * Get ingestion statistics.
+ * @param stats output statistics
+ */
+void ingest_stats(struct ingest_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,70 @@
+// SPDX-License-Identifier: MIT
+// Per-message bump allocator for cJSON.
+
+#include "json_arena.h"
+
+#include "cJSON.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+// Alignment of allocations, enough for double
+#define ARENA_ALIGN 8
+
+static union {
+    double align;
+    uint8_t bytes[JSON_ARENA_SIZE];
+} arena;
+static size_t arena_used;
+static struct json_arena_stats stats;
+
+static bool in_arena(const void* ptr)
+{
+    const uint8_t* p = ptr;
+    return p >= arena.bytes && p < arena.bytes + JSON_ARENA_SIZE;
+}
+
+static void* arena_malloc(size_t size)
+{
+    const size_t aligned =
+        (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    if (aligned > JSON_ARENA_SIZE - arena_used) {
+        ++stats.heap_allocs;
+        return malloc(size);
+    }
+    void* ptr = &arena.bytes[arena_used];
+    arena_used += aligned;
+    if (arena_used > stats.high_water) {
+        stats.high_water = arena_used;
+    }
+    ++stats.allocs;
+    return ptr;
+}
+
+static void arena_free(void* ptr)
+{
+    if (!in_arena(ptr)) {
+        free(ptr);
+    }
+}
+
+void json_arena_init(void)
+{
+    cJSON_Hooks hooks = {
+        .malloc_fn = arena_malloc,
+        .free_fn = arena_free,
+    };
+    cJSON_InitHooks(&hooks);
+    arena_used = 0;
+}
+
+void json_arena_reset(void)
+{
+    arena_used = 0;
+    ++stats.resets;
+}
+
+void json_arena_stats(struct json_arena_stats* out)
+{
+    *out = stats;
+}
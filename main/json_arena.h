@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: MIT
+// Per-message bump allocator for cJSON.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Arena size in bytes, allocated statically in internal RAM
+#ifndef JSON_ARENA_SIZE
+#define JSON_ARENA_SIZE 4096
+#endif
+
+/**
+ * Arena statistics.
+ */
+struct json_arena_stats {
+    size_t high_water;    // max bytes used by one message
+    uint32_t allocs;      // allocations served from the arena
+    uint32_t heap_allocs; // allocations that did not fit, served from heap
+    uint32_t resets;
+};
+
+/**
+ * Install the arena as cJSON allocator. Allocations that do not fit into
+ * the arena fall back to the system heap. Freeing arena memory is a no-op,
+ * it is reclaimed by json_arena_reset.
+ */
+void json_arena_init(void);
+
+/**
+ * Release all arena memory, called when no cJSON item is alive
+ * (after cJSON_Delete of the message tree).
+ */
+void json_arena_reset(void);
+
+/**
+ * Get arena statistics.
+ * @param stats output statistics
+ */
+void json_arena_stats(struct json_arena_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
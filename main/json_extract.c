@@ -0,0 +1,296 @@
+// SPDX-License-Identifier: MIT
+// Streaming extractor of top-level JSON object fields.
+
+#include "json_extract.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Max length of a number token
+#define NUMBER_MAX 63
+
+// Max depth of skipped nested values
+#define NESTING_MAX 32
+
+// Read position in the JSON text
+struct cursor {
+    const char* pos;
+    const char* end;
+};
+
+static void skip_space(struct cursor* cur)
+{
+    while (cur->pos < cur->end &&
+           (*cur->pos == ' ' || *cur->pos == '\t' || *cur->pos == '\n' ||
+            *cur->pos == '\r')) {
+        ++cur->pos;
+    }
+}
+
+static bool consume(struct cursor* cur, char ch)
+{
+    skip_space(cur);
+    if (cur->pos < cur->end && *cur->pos == ch) {
+        ++cur->pos;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Scan string, cursor must be at the opening quote.
+ * @param cur read position
+ * @param str output string content
+ * @param length output content length
+ * @param escaped set if the string contains escape sequences
+ * @return false on unterminated string
+ */
+static bool scan_string(struct cursor* cur, const char** str, size_t* length,
+                        bool* escaped)
+{
+    const char* start = ++cur->pos;
+    *escaped = false;
+    while (cur->pos < cur->end) {
+        const char ch = *cur->pos;
+        if (ch == '"') {
+            *str = start;
+            *length = cur->pos - start;
+            ++cur->pos;
+            return true;
+        }
+        if (ch == '\\') {
+            *escaped = true;
+            ++cur->pos;
+        } else if ((unsigned char)ch < ' ') {
+            return false;
+        }
+        ++cur->pos;
+    }
+    return false;
+}
+
+static bool scan_number(struct cursor* cur, double* number)
+{
+    char token[NUMBER_MAX + 1];
+    size_t length = 0;
+
+    while (cur->pos + length < cur->end && length < NUMBER_MAX) {
+        const char ch = cur->pos[length];
+        if ((ch < '0' || ch > '9') && ch != '-' && ch != '+' && ch != '.' &&
+            ch != 'e' && ch != 'E') {
+            break;
+        }
+        token[length++] = ch;
+    }
+    token[length] = 0;
+
+    char* token_end;
+    *number = strtod(token, &token_end);
+    if (token_end == token) {
+        return false;
+    }
+    cur->pos += token_end - token;
+    return true;
+}
+
+static bool scan_literal(struct cursor* cur, const char* literal)
+{
+    const size_t length = strlen(literal);
+    if ((size_t)(cur->end - cur->pos) < length ||
+        memcmp(cur->pos, literal, length)) {
+        return false;
+    }
+    cur->pos += length;
+    return true;
+}
+
+/**
+ * Skip object or array, cursor must be at the opening bracket.
+ * Brackets are balanced, content is not validated.
+ */
+static bool skip_nested(struct cursor* cur)
+{
+    char closing[NESTING_MAX];
+    size_t depth = 0;
+
+    while (cur->pos < cur->end) {
+        const char ch = *cur->pos;
+        if (ch == '"') {
+            const char* str;
+            size_t length;
+            bool escaped;
+            if (!scan_string(cur, &str, &length, &escaped)) {
+                return false;
+            }
+            continue;
+        }
+        if (ch == '{' || ch == '[') {
+            if (depth == NESTING_MAX) {
+                return false;
+            }
+            closing[depth++] = ch == '{' ? '}' : ']';
+        } else if (ch == '}' || ch == ']') {
+            if (!depth || closing[--depth] != ch) {
+                return false;
+            }
+            if (!depth) {
+                ++cur->pos;
+                return true;
+            }
+        }
+        ++cur->pos;
+    }
+    return false;
+}
+
+/**
+ * Scan any value.
+ * @param cur read position
+ * @param value output value, NULL to skip the value
+ * @param escaped set if the value is an escaped string
+ * @return false on syntax error
+ */
+static bool scan_value(struct cursor* cur, struct json_value* value,
+                       bool* escaped)
+{
+    struct json_value tmp;
+    if (!value) {
+        value = &tmp;
+    }
+    *escaped = false;
+
+    skip_space(cur);
+    if (cur->pos == cur->end) {
+        return false;
+    }
+    switch (*cur->pos) {
+        case '"':
+            value->type = JSON_STRING;
+            return scan_string(cur, &value->string, &value->length, escaped);
+        case '{':
+        case '[':
+            value->type = JSON_NESTED;
+            return skip_nested(cur);
+        case 't':
+            value->type = JSON_TRUE;
+            return scan_literal(cur, "true");
+        case 'f':
+            value->type = JSON_FALSE;
+            return scan_literal(cur, "false");
+        case 'n':
+            value->type = JSON_NULL;
+            return scan_literal(cur, "null");
+        default:
+            value->type = JSON_NUMBER;
+            return scan_number(cur, &value->number);
+    }
+}
+
+static int find_key(const char* key, size_t length, const char* const* keys,
+                    size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        if (keys[i][0] == key[0] && !strncmp(keys[i], key, length) &&
+            keys[i][length] == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+enum json_extract_result json_extract(const char* data, size_t size,
+                                      const char* const* keys,
+                                      struct json_value* values, size_t count)
+{
+    struct cursor cur = { .pos = data, .end = data + size };
+    bool fallback = false;
+
+    for (size_t i = 0; i < count; ++i) {
+        values[i].type = JSON_MISSING;
+    }
+
+    if (!consume(&cur, '{')) {
+        return JSON_EXTRACT_INVALID;
+    }
+    if (consume(&cur, '}')) {
+        return JSON_EXTRACT_OK;
+    }
+
+    do {
+        const char* key;
+        size_t length;
+        bool escaped;
+
+        skip_space(&cur);
+        if (cur.pos == cur.end || *cur.pos != '"' ||
+            !scan_string(&cur, &key, &length, &escaped) ||
+            !consume(&cur, ':')) {
+            return JSON_EXTRACT_INVALID;
+        }
+
+        if (escaped) {
+            fallback = true; // key may be an escaped wanted key
+        }
+        int index = escaped ? -1 : find_key(key, length, keys, count);
+        if (index >= 0 && values[index].type != JSON_MISSING) {
+            index = -1; // duplicate key, first one wins
+        }
+        struct json_value* value = index >= 0 ? &values[index] : NULL;
+        if (!scan_value(&cur, value, &escaped)) {
+            return JSON_EXTRACT_INVALID;
+        }
+        if (value && escaped) {
+            fallback = true;
+        }
+    } while (consume(&cur, ','));
+
+    if (!consume(&cur, '}')) {
+        return JSON_EXTRACT_INVALID;
+    }
+    return fallback ? JSON_EXTRACT_FALLBACK : JSON_EXTRACT_OK;
+}
+
+void json_extract_tree(const cJSON* root, const char* const* keys,
+                       struct json_value* values, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        const cJSON* item = cJSON_GetObjectItemCaseSensitive(root, keys[i]);
+        struct json_value* value = &values[i];
+        if (!item) {
+            value->type = JSON_MISSING;
+        } else if (cJSON_IsString(item)) {
+            value->type = JSON_STRING;
+            value->string = item->valuestring;
+            value->length = strlen(item->valuestring);
+        } else if (cJSON_IsNumber(item)) {
+            value->type = JSON_NUMBER;
+            value->number = item->valuedouble;
+        } else if (cJSON_IsTrue(item)) {
+            value->type = JSON_TRUE;
+        } else if (cJSON_IsFalse(item)) {
+            value->type = JSON_FALSE;
+        } else if (cJSON_IsNull(item)) {
+            value->type = JSON_NULL;
+        } else {
+            value->type = JSON_NESTED;
+        }
+    }
+}
+
+bool json_value_equals(const struct json_value* value, const char* str)
+{
+    return value->type == JSON_STRING &&
+        !strncmp(value->string, str, value->length) && str[value->length] == 0;
+}
+
+int json_value_int(const struct json_value* value)
+{
+    if (value->number >= INT_MAX) {
+        return INT_MAX;
+    }
+    if (value->number <= (double)INT_MIN) {
+        return INT_MIN;
+    }
+    return (int)value->number;
+}
@@ -0,0 +1,84 @@
+// SPDX-License-Identifier: MIT
+// Streaming extractor of top-level JSON object fields.
+
+#pragma once
+
+#include "cJSON.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum json_type {
+    JSON_MISSING, // key not present
+    JSON_STRING,
+    JSON_NUMBER,
+    JSON_TRUE,
+    JSON_FALSE,
+    JSON_NULL,
+    JSON_NESTED, // object or array
+};
+
+enum json_extract_result {
+    JSON_EXTRACT_OK,
+    JSON_EXTRACT_FALLBACK, // escape sequences in a wanted key or value
+    JSON_EXTRACT_INVALID,  // not a JSON object
+};
+
+/**
+ * Extracted value, strings point into the parsed buffer.
+ */
+struct json_value {
+    enum json_type type;
+    const char* string; // not NUL-terminated
+    size_t length;      // string length
+    double number;
+};
+
+/**
+ * Extract values of wanted keys from the top level of a JSON object in a
+ * single pass, without allocations. Only the first occurrence of a key is
+ * used, nested objects and arrays are skipped.
+ * @param data JSON text, does not need to be NUL-terminated
+ * @param size JSON text size
+ * @param keys wanted keys
+ * @param values output values, one per key
+ * @param count number of keys
+ * @return JSON_EXTRACT_OK if all values are set, JSON_EXTRACT_FALLBACK if
+ *         the payload needs a full parser to unescape strings
+ */
+enum json_extract_result json_extract(const char* data, size_t size,
+                                      const char* const* keys,
+                                      struct json_value* values, size_t count);
+
+/**
+ * Get wanted keys from a cJSON tree, used as fallback of json_extract.
+ * @param root parsed object, must outlive the values
+ * @param keys wanted keys
+ * @param values output values, one per key
+ * @param count number of keys
+ */
+void json_extract_tree(const cJSON* root, const char* const* keys,
+                       struct json_value* values, size_t count);
+
+/**
+ * Compare string value.
+ * @param value extracted value
+ * @param str NUL-terminated string to compare with
+ * @return true if value is a string equal to str
+ */
+bool json_value_equals(const struct json_value* value, const char* str);
+
+/**
+ * Get number as int, saturated the same way as cJSON valueint.
+ * @param value extracted number
+ * @return integer value
+ */
+int json_value_int(const struct json_value* value);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: MIT
+// Latest-value mailbox of measurements, one slot per measurement type.
+
+#include "mailbox.h"
+
+#include <string.h>
+
+const uint32_t mailbox_lanes[MAILBOX_LANES] = {
+    [LANE_ALARM] = MAILBOX_ALARMS,
+    [LANE_STATE] = MAILBOX_STATES,
+    [LANE_COSMETIC] = MAILBOX_COSMETIC,
+};
+
+static struct measurement slots[MAILBOX_SLOTS];
+static uint32_t dirty;
+static TaskHandle_t reader;
+static struct mailbox_stats stats;
+// posters run on both cores
+static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+void mailbox_init(TaskHandle_t consumer)
+{
+    portENTER_CRITICAL(&lock);
+    dirty = 0;
+    memset(&stats, 0, sizeof(stats));
+    reader = consumer;
+    portEXIT_CRITICAL(&lock);
+}
+
+// Slot bits of the lane of a measurement type
+static uint32_t lane_of(uint32_t bit)
+{
+    for (int lane = 0; lane < MAILBOX_LANES; ++lane) {
+        if (mailbox_lanes[lane] & bit) {
+            return mailbox_lanes[lane];
+        }
+    }
+    return bit;
+}
+
+bool mailbox_post(const struct measurement* meas)
+{
+    const uint32_t bit = MAILBOX_BIT(meas->id);
+    const uint32_t lane = lane_of(bit);
+    bool notify;
+    bool replaced;
+
+    portENTER_CRITICAL(&lock);
+    ++stats.posted;
+    replaced = dirty & bit;
+    if (replaced) {
+        ++stats.overwritten[meas->id];
+    }
+    slots[meas->id] = *meas;
+    // one notification per lane and batch, slots of a lane are taken at
+    // once; a lane left pending does not hide posts to the other lanes
+    notify = !(dirty & lane);
+    dirty |= bit;
+    portEXIT_CRITICAL(&lock);
+
+    if (notify && reader) {
+        xTaskNotifyGive(reader);
+    }
+    return replaced;
+}
+
+bool mailbox_wait(TickType_t timeout)
+{
+    return ulTaskNotifyTake(pdTRUE, timeout) != 0;
+}
+
+uint32_t mailbox_pending(void)
+{
+    return __atomic_load_n(&dirty, __ATOMIC_RELAXED);
+}
+
+uint32_t mailbox_take(struct measurement* out, uint32_t types)
+{
+    portENTER_CRITICAL(&lock);
+    const uint32_t taken = dirty & types;
+    for (uint32_t pending = taken; pending; pending &= pending - 1) {
+        const int id = __builtin_ctz(pending);
+        out[id] = slots[id];
+    }
+    dirty &= ~taken;
+    portEXIT_CRITICAL(&lock);
+    return taken;
+}
+
+void mailbox_stats(struct mailbox_stats* out)
+{
+    portENTER_CRITICAL(&lock);
+    *out = stats;
+    portEXIT_CRITICAL(&lock);
+}
@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: MIT
+// Latest-value mailbox of measurements, one slot per measurement type.
+
+#pragma once
+
+#include "display.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Number of slots, one per measurement type
+#define MAILBOX_SLOTS (AVGPRICE + 1)
+
+// Slot bit of a measurement type
+#define MAILBOX_BIT(type) (1u << (type))
+
+// Priority classes of the measurement types
+#define MAILBOX_ALARMS   (MAILBOX_BIT(DOOR) | MAILBOX_BIT(FLOOD))
+#define MAILBOX_STATES   (MAILBOX_BIT(COMM) | MAILBOX_BIT(LEVEL) | \
+                          MAILBOX_BIT(CARHEATER) | MAILBOX_BIT(OILBURNER) | \
+                          MAILBOX_BIT(STOCKHEAT) | MAILBOX_BIT(SOLHEAT))
+#define MAILBOX_COSMETIC (MAILBOX_BIT(TEMPERATURE) | MAILBOX_BIT(TIME) | \
+                          MAILBOX_BIT(PRICE) | MAILBOX_BIT(AVGPRICE))
+
+/**
+ * Priority lane: alarms are rendered first and at once, states on the
+ * next frame, cosmetic updates at a reduced rate.
+ */
+enum mailbox_lane {
+    LANE_ALARM,
+    LANE_STATE,
+    LANE_COSMETIC,
+    MAILBOX_LANES
+};
+
+// Slot bits of every lane, indexed by enum mailbox_lane
+extern const uint32_t mailbox_lanes[MAILBOX_LANES];
+
+/**
+ * Mailbox statistics.
+ */
+struct mailbox_stats {
+    uint32_t posted;
+    uint32_t overwritten[MAILBOX_SLOTS]; // replaced before it was rendered
+};
+
+/**
+ * Initialize empty mailbox.
+ * @param consumer task notified when a slot is written
+ */
+void mailbox_init(TaskHandle_t consumer);
+
+/**
+ * Store measurement into the slot of its type, replacing a value not yet
+ * taken. The consumer is notified on the first post to a lane since it
+ * was taken. Never blocks.
+ * @param meas measurement
+ * @return true if a value not yet taken was replaced
+ */
+bool mailbox_post(const struct measurement* meas);
+
+/**
+ * Wait until a slot is written.
+ * @param timeout max ticks to wait
+ * @return false on timeout
+ */
+bool mailbox_wait(TickType_t timeout);
+
+/**
+ * Get written slots not yet taken.
+ * @return bitmap of the slots, bit n is measurement type n
+ */
+uint32_t mailbox_pending(void);
+
+/**
+ * Take written slots.
+ * @param slots output, indexed by measurement type, MAILBOX_SLOTS entries;
+ *        only the slots marked in the returned bitmap are written
+ * @param types bitmap of the slots to take, others stay written
+ * @return bitmap of the taken slots, bit n is measurement type n
+ */
+uint32_t mailbox_take(struct measurement* slots, uint32_t types);
+
+/**
+ * Get mailbox statistics.
+ * @param stats output statistics
+ */
+void mailbox_stats(struct mailbox_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
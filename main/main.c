@@ -1,8 +1,16 @@
 // SPDX-License-Identifier: MIT
 // Super-duper-clock.
 
+#include "capture.h"
+#include "console.h"
 #include "display.h"
-#include "cJSON.h"
+#include "ingest.h"
+#include "json_arena.h"
+#include "mailbox.h"
+#include "reassembly.h"
+#include "spsc_ring.h"
+#include "state.h"
+#include "trace.h"
 
 //#include <bme280.h>
 #include <driver/gpio.h>
@@ -11,6 +19,7 @@
 #include <esp_timer.h>
 #include <esp_wifi.h>
 #include <freertos/queue.h>
+#include <freertos/task.h>
 #include "esp_mac.h"
 #include "esp_netif.h"
 #include "esp_event.h"
@@ -27,14 +36,57 @@
 #define INDEX_STOCKHEATER   4
 #define INDEX_SOLHEATER     5
 
-#define FLOODFLAG_TRASH     1
-#define FLOODFLAG_LATTIA    2
-#define FLOODFLAG_TISKIKONE 4
-
-#define DOORFLAG_STORE     1
-#define DOORFLAG_BOILER    2
-#define DOORFLAG_BALKONG   4
-#define DOORFLAG_FRONT     8
+// Frame scheduler: queued measurements are rendered at most this often
+#define FRAME_RATE_HZ       25
+
+// Measurement path to the render task: FIFO queue, latest value per
+// measurement type where a burst collapses to the newest state, lock-free
+// rings, one per producer task, or seqlock snapshots of the state store
+#define RENDER_INPUT_QUEUE   0
+#define RENDER_INPUT_MAILBOX 1
+#define RENDER_INPUT_RING    2
+#define RENDER_INPUT_STATE   3
+#ifndef RENDER_INPUT
+#define RENDER_INPUT         RENDER_INPUT_STATE
+#endif
+// Latest value inputs render in priority lanes
+#define RENDER_LANES (RENDER_INPUT == RENDER_INPUT_MAILBOX || \
+                      RENDER_INPUT == RENDER_INPUT_STATE)
+
+// Min period of cosmetic updates (clock, prices, temperature) with
+// RENDER_LANES, updates in between collapse to the newest
+#define COSMETIC_PERIOD_MS   250
+
+// Alarm interval of the console flood test, in posted measurements
+#define FLOOD_ALARM_EVERY    50
+
+// Max number of tasks posting measurements with RENDER_INPUT_RING: main,
+// event loop, esp_timer, lwIP (NTP callback) and MQTT
+#define RENDER_RING_PRODUCERS 6
+
+// Measurements of one frame traced with RENDER_INPUT_QUEUE and
+// RENDER_INPUT_RING, the rest are rendered untraced
+#define FRAME_TRACE_MAX      32
+
+// Render task, runs on the core not used by WiFi/lwIP
+#define RENDER_TASK_STACK    4096
+#define RENDER_TASK_PRIORITY 5
+#if CONFIG_FREERTOS_UNICORE
+#define RENDER_TASK_CORE     0
+#else
+#define RENDER_TASK_CORE     1
+#endif
+
+// Subscriptions: bytes of one SUBSCRIBE packet (esp-mqtt builds the packet
+// in its output buffer, 1024 bytes by default)
+#define SUBSCRIBE_PACKET_MAX 1024
+
+// Statistics report period, and the topic of the latency report
+#define STATS_PERIOD_MS      60000
+#define STATS_TOPIC          "home/kallio/monitor/stats"
+#define STATS_JSON_MAX       3072
+// Per-task CPU time report (needs FreeRTOS run time stats)
+#define TASK_STATS_MAX       32
 
 
 // Log tag
@@ -43,8 +95,30 @@ static const char* log_tag = "monitor";
 //static bme280_handle_t bme280;
 // Current info to display
 //static struct info info;
-static struct commState commInfo;
+#if RENDER_INPUT == RENDER_INPUT_QUEUE
 static QueueHandle_t evt_queue = NULL;
+#elif RENDER_LANES
+// queued to flushed latency of every priority lane, written by the render task
+static struct {
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t total_us;
+} laneLatency[MAILBOX_LANES];
+#if RENDER_INPUT == RENDER_INPUT_STATE
+// state shown on the display, updated by the render task
+static struct state_snapshot shown;
+static TaskHandle_t renderHandle;
+// repaint the whole screen from the state store
+static bool redrawPending;
+#endif
+#elif RENDER_INPUT == RENDER_INPUT_RING
+// ring of every producer task, claimed on the first post
+static struct {
+    TaskHandle_t owner;
+    struct spsc_ring ring;
+} renderRings[RENDER_RING_PRODUCERS];
+static TaskHandle_t renderHandle;
+#endif
 
 
 
@@ -56,102 +130,128 @@ static void log_error_if_nonzero(const char *message, int error_code)
 }
 
 
-static char *getJsonStr(cJSON *js, char *name)
+#if RENDER_INPUT == RENDER_INPUT_RING
+// Ring of the calling task, NULL if all rings are taken by other tasks
+static struct spsc_ring *producerRing(void)
 {
-    cJSON *item = cJSON_GetObjectItem(js, name);
-    if (item != NULL)
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+
+    for (int i = 0; i < RENDER_RING_PRODUCERS; ++i)
     {
-        if (cJSON_IsString(item))
+        TaskHandle_t owner = __atomic_load_n(&renderRings[i].owner, __ATOMIC_ACQUIRE);
+        if (!owner)
         {
-            return item->valuestring;
+            __atomic_compare_exchange_n(&renderRings[i].owner, &owner, self, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+            owner = owner ? owner : self;
+        }
+        if (owner == self)
+        {
+            return &renderRings[i].ring;
         }
-        else ESP_LOGI(log_tag, "%s is not a string", name);
     }
-    else ESP_LOGI(log_tag,"%s not found from json", name);
-    return "\0";
+    return NULL;
 }
+#endif
 
-static bool getJsonState(cJSON *js, char *name)
+// Store measurement and send it to the render loop, updates made on the
+// device are received and parsed when posted
+static void postMeas(struct measurement *meas)
 {
-    cJSON *item = cJSON_GetObjectItem(js, name);
-    if (item != NULL)
+    meas->queued_us = esp_timer_get_time();
+    if (!meas->received_us)
     {
-        if (item->type == 2)
-        //if (cJSON_IsTrue(item)) bug in library
-        {
-            return true;
-        }
+        meas->received_us = meas->parsed_us = meas->queued_us;
+    }
+#if RENDER_INPUT == RENDER_INPUT_STATE
+    if (state_set(meas))
+    {
+        trace_overwritten();
     }
-    else ESP_LOGI(log_tag,"%s not found from json", name);
-    return false;
+#elif RENDER_INPUT == RENDER_INPUT_MAILBOX
+    state_set(meas);
+    if (mailbox_post(meas))
+    {
+        trace_overwritten();
+    }
+#elif RENDER_INPUT == RENDER_INPUT_RING
+    state_set(meas);
+    struct spsc_ring *ring = producerRing();
+    bool wake;
+    if (!ring || !spsc_ring_push(ring, meas, &wake))
+    {
+        trace_full();
+    }
+    else if (wake)
+    {
+        xTaskNotifyGive(renderHandle);
+    }
+#else
+    state_set(meas);
+    if (xQueueSend(evt_queue, meas, 0) != pdTRUE)
+    {
+        trace_full();
+    }
+#endif
 }
 
+// Connection links shown by the comm indicator
+#define LINK_WIFI 0x1
+#define LINK_NTP  0x2
+#define LINK_MQTT 0x4
 
-static bool getJsonInt(cJSON *js, char *name, int *val)
+// Set connection links up or down in the state store, the other links
+// keep their state
+static void dispComm(unsigned links, bool up)
 {
-    bool ret = false;
-
-    cJSON *item = cJSON_GetObjectItem(js, name);
-    if (item != NULL)
+    const int64_t now = esp_timer_get_time();
+    struct measurement *meas = state_write_begin(COMM);
+    const struct commState old = meas->data.comm;
+    if (links & LINK_WIFI) meas->data.comm.wifi = up;
+    if (links & LINK_NTP) meas->data.comm.ntp = up;
+    if (links & LINK_MQTT) meas->data.comm.mqtt = up;
+    // the first write shows the indicator
+    const bool changed = !meas->queued_us ||
+                         old.wifi != meas->data.comm.wifi ||
+                         old.ntp != meas->data.comm.ntp ||
+                         old.mqtt != meas->data.comm.mqtt;
+    if (changed)
     {
-        if (cJSON_IsNumber(item))
-        {
-            if (item->valueint != *val)
-            {
-                ret = true;
-                *val = item->valueint;
-            }
-        }
-        else ESP_LOGI(log_tag,"%s is not a number", name);
+        meas->received_us = meas->parsed_us = meas->queued_us = now;
     }
-    else ESP_LOGI(log_tag,"%s not found from json", name);
-    return ret;
-}
-
-static bool getJsonFloat(cJSON *js, char *name, float *val)
-{
-    bool ret = false;
-
-    cJSON *item = cJSON_GetObjectItem(js, name);
-    if (item != NULL)
+#if RENDER_INPUT != RENDER_INPUT_STATE
+    struct measurement posted = *meas;
+#endif
+    state_write_end(COMM, changed);
+#if RENDER_INPUT != RENDER_INPUT_STATE
+    // the store holds the value already, postMeas only forwards it
+    if (changed)
     {
-        if (cJSON_IsNumber(item))
-        {
-            if (item->valuedouble != *val)
-            {
-                ret = true;
-                *val = item->valuedouble;
-            }
-        }
-        else ESP_LOGI(log_tag,"%s is not a number", name);
+        postMeas(&posted);
     }
-    else ESP_LOGI(log_tag,"%s not found from json", name);
-    return ret;
-}
-
-static void dispComm(struct commState *state)
-{
-    struct measurement meas;
-    meas.id = COMM;
-    meas.data.comm.wifi = state->wifi;
-    meas.data.comm.ntp = state->ntp;
-    meas.data.comm.mqtt = state->mqtt;
-    xQueueSend(evt_queue, &meas, 0);
+#endif
 }
 
 
 static void dispTime(struct tm *now_local)
 {
-    struct measurement meas;
+    struct measurement meas = { 0 };
     meas.id = TIME;
     meas.data.time.hours   = now_local->tm_hour;
     meas.data.time.minutes = now_local->tm_min;
     meas.data.time.seconds = now_local->tm_sec;
-    xQueueSend(evt_queue, &meas, 0);
+    postMeas(&meas);
 }
 
 
-// Timer callback: called once per 5 second
+// Clock update period
+#if DISPLAY_SECONDS
+#define CLOCK_TICK_US 1000000
+#else
+#define CLOCK_TICK_US 5000000
+#endif
+
+// Timer callback: called once per clock tick
 static void on_clock_tick(void* arg)
 {
     time_t now_utc;
@@ -168,8 +268,7 @@ static void on_clock_tick(void* arg)
 static void on_time_sync(struct timeval* tv)
 {
     ESP_LOGI(log_tag, "NTP sync completed");
-    commInfo.ntp = true;
-    dispComm(&commInfo);
+    dispComm(LINK_NTP, true);
 }
 
 // Initialize Network Time Protocol client
@@ -189,15 +288,12 @@ static void on_net_event(void* arg, esp_event_base_t event_base,
         if (event_id == WIFI_EVENT_STA_START ||
             event_id == WIFI_EVENT_STA_DISCONNECTED) {
             ESP_LOGW(log_tag, "Reconnect WiFi");
-            commInfo.wifi = false;
-            commInfo.ntp = false;
-            dispComm(&commInfo);
+            dispComm(LINK_WIFI | LINK_NTP, false);
             esp_wifi_connect();
         }
     } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
         ESP_LOGI(log_tag, "WiFi connected");
-        commInfo.wifi = true;
-        dispComm(&commInfo);
+        dispComm(LINK_WIFI, true);
         ntp_init();
     }
 }
@@ -238,331 +334,94 @@ static void wifi_init(void)
 
 static void dispPrice(float price, int level)
 {
-    struct measurement meas;
+    struct measurement meas = { 0 };
 
     meas.id = PRICE;
     meas.data.price.euros = price;
     meas.data.price.level = level;
-    xQueueSend(evt_queue, &meas, 0);
+    postMeas(&meas);
 }
 
 static void dispAvgPrice(float price)
 {
-    struct measurement meas;
+    struct measurement meas = { 0 };
 
     meas.id = AVGPRICE;
     meas.data.price.euros = price;
     meas.data.price.level = normal;
-    xQueueSend(evt_queue, &meas, 0);
+    postMeas(&meas);
 }
 
 static void dispTemperature(float temperature)
 {
-    struct measurement meas;
+    struct measurement meas = { 0 };
 
     meas.id = TEMPERATURE;
     meas.data.heater.temperature = temperature;
-    xQueueSend(evt_queue, &meas, 0);
+    postMeas(&meas);
 }
 
 static void dispLevel(int level)
 {
-    struct measurement meas;
+    struct measurement meas = { 0 };
 
     meas.id = LEVEL;
     meas.data.heater.level = level;
-    xQueueSend(evt_queue, &meas, 0);
+    postMeas(&meas);
 }
 
 static void dispState(enum indicator state, enum meastype id)
 {
-    struct measurement meas;
+    struct measurement meas = { 0 };
 
     meas.id = id;
     meas.data.indic = state;
-    xQueueSend(evt_queue, &meas, 0);
+    postMeas(&meas);
 }
 
-char const * const hometopic   = "home/kallio";
-const char * const zigbeetopic = "zigbee2mqtt";
-
-
-struct messageId {
-    char const * const baseTopic;
-    const char * const subTopic;
-    const char *id;
-    const int num;
-};
-
-struct messageId messageIds[] = {
-    {hometopic,      NULL,               "thermostat",       0},
-    {hometopic,      NULL,               "temperature",      1},
-    {hometopic,      NULL,               "relay",            2},
-    {hometopic,      NULL,               "elprice",          9},    
-    {hometopic,      NULL,               "daystats",         11},
-    {zigbeetopic,   "store_door",        NULL,               3},
-    {zigbeetopic,   "boiler_door",       NULL,               4},
-    {zigbeetopic,   "balkong_door",      NULL,               5},
-    {zigbeetopic,   "front_door",        NULL,               10},
-    {zigbeetopic,   "kitchen_trash",     NULL,               6},
-    {zigbeetopic,   "lattia",            NULL,               7},
-    {zigbeetopic,   "tiskikone",         NULL,               8},
-    {NULL,NULL,NULL,-1}
-};
-
-
-static int resolveWhichMessage(esp_mqtt_event_handle_t event, cJSON *cjson)
+/*
+ * Subscribe to the topic filters of the bindings, as many filters per
+ * SUBSCRIBE packet as fit in the client output buffer.
+ */
+static void subscribeTopics(esp_mqtt_client_handle_t client)
 {
-    if (event->topic == NULL) return -1;
-
-    int len;
-    char id[20];
-    char zigbee[30];
-    
-    for (int i=0; messageIds[i].baseTopic != NULL; i++)
-    {
-        if (messageIds[i].subTopic == NULL)
-        {
-            if (!memcmp(event->topic,messageIds[i].baseTopic,strlen(messageIds[i].baseTopic)))
-            {
-                strcpy(id,getJsonStr(cjson,"id"));
-                if (!strcmp(id,messageIds[i].id))
-                {
-                    return messageIds[i].num;
-                }
-            }
-        }
-        else
-        {
-            len = sprintf(zigbee,"%s/%s",messageIds[i].baseTopic, messageIds[i].subTopic);
-            if (!memcmp(event->topic, zigbee, len))
-            {
-                ESP_LOGI(log_tag, "%s changed", zigbee);
-                return messageIds[i].num;
+    // one filter per binding at most, static to spare the MQTT task stack
+    static const char *filters[INGEST_BINDINGS];
+    static esp_mqtt_topic_t topics[INGEST_BINDINGS];
+    size_t count = ingest_topics(filters, INGEST_BINDINGS);
+    size_t batch = 0;
+    size_t packets = 0;
+    size_t bytes = 7; // fixed header and packet id
+
+    if (count > INGEST_BINDINGS) {
+        ESP_LOGE(log_tag, "%u topic filters left out, not subscribed",
+                 (unsigned)(count - INGEST_BINDINGS));
+        count = INGEST_BINDINGS;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        // filter length, name and QoS
+        size_t size = 2 + strlen(filters[i]) + 1;
+        if (batch && bytes + size > SUBSCRIBE_PACKET_MAX) {
+            if (esp_mqtt_client_subscribe_multiple(client, topics, batch) < 0) {
+                ESP_LOGE(log_tag, "Subscribe failed");
             }
+            ++packets;
+            batch = 0;
+            bytes = 7;
         }
+        topics[batch].filter = filters[i];
+        topics[batch].qos = 0;
+        ++batch;
+        bytes += size;
     }
-    return -1;
-}
-
-static int todayNum(void)
-{
-    time_t now_utc;
-    struct tm now_local;
-
-    time(&now_utc);
-    localtime_r(&now_utc, &now_local);
-    return now_local.tm_wday;
-}
-
-static uint16_t handleJson(esp_mqtt_event_handle_t event, uint8_t *chipid)
-{
-    cJSON *root = cJSON_Parse(event->data);
-    time_t now;
-    bool flagsChanged=false;
-    static float avgDayPrice = -10;
-    static int floodFlag = 0x0;
-    static int doorFlag  = 0x0;
-
-    time(&now);
-    if (root != NULL)
-    {
-        switch (resolveWhichMessage(event, root))
-        {
-            case 0:
-                {
-                    int val=-1;
-                    if (getJsonInt(root,"value",&val))
-                    {
-                        dispLevel(val);
-                    }
-                }
-                break;
-
-            case 1:
-                if (!strcmp(getJsonStr(root,"sensor"),"ntc"))
-                {
-                    float val=0;
-                    if (getJsonFloat(root,"value",&val))
-                    {
-                        ESP_LOGI(log_tag,"got some temperature %.2f", val);
-                        dispTemperature(val);
-                    }
-                }
-                break;
-
-            case 2:
-                {
-                    char device[20];
-                    float power=-1.0;
-                    bool state = getJsonState(root,"state");
-                    int contact = -1;
-
-                    getJsonInt(root,"contact", &contact);
-                    strcpy(device,getJsonStr(root,"device"));
-                    if (!strcmp(device, "shellyplus1pm"))
-                    {
-                        if (!state)
-                        {
-                            dispState(INDICATOR_OFF, CARHEATER);
-                        }
-                        else
-                        {
-                            if (getJsonFloat(root,"power",&power))
-                            {
-                                ESP_LOGI(log_tag,"got power %.2f", power);
-                                if (power > 10.0)
-                                {
-                                    dispState(INDICATOR_CONNECTED, CARHEATER);
-                                }
-                                else
-                                {
-                                    dispState(INDICATOR_ON, CARHEATER);
-                                }
-                            }
-                        }
-                    }
-                    if (!strcmp(device,"shelly1"))
-                    {
-                        switch (contact)
-                        {
-                            case 0: // solarheater
-                                if (!state) dispState(INDICATOR_OFF, SOLHEAT);
-                                else dispState(INDICATOR_CONNECTED, SOLHEAT);
-                            break;
-
-                            case 1:
-                            break;
-
-                            case 2: // stockheater
-                                if (!state) dispState(INDICATOR_OFF, STOCKHEAT);
-                                else dispState(INDICATOR_CONNECTED, STOCKHEAT);
-
-                            break;
-
-                            case 3:
-                                if (!state)  dispState(INDICATOR_OFF, OILBURNER);
-                                else dispState(INDICATOR_CONNECTED, OILBURNER);
-                            break;
-                        }
-                    }
-                }
-                break;
-
-
-            case 3:
-                flagsChanged = true;
-                if (!getJsonState(root,"contact"))
-                    doorFlag |= DOORFLAG_STORE;
-                else
-                    doorFlag &= ~DOORFLAG_STORE;
-                break;
-
-            case 4:
-                flagsChanged = true;
-                if (!getJsonState(root,"contact"))
-                    doorFlag |= DOORFLAG_BOILER;
-                else
-                    doorFlag &= ~DOORFLAG_BOILER;
-                break;
-
-            case 5:
-                flagsChanged = true;
-                if (!getJsonState(root,"contact"))
-                    doorFlag |= DOORFLAG_BALKONG;
-                else
-                    doorFlag &= ~DOORFLAG_BALKONG;
-                break;
-
-            case 6:
-                flagsChanged = true;
-                if (getJsonState(root,"water_leak"))
-                    floodFlag |= FLOODFLAG_TRASH;
-                else
-                    floodFlag &= ~FLOODFLAG_TRASH;
-                break;
-
-            case 7:
-                flagsChanged = true;
-                if (getJsonState(root,"water_leak"))
-                    floodFlag |= FLOODFLAG_LATTIA;
-                else
-                    floodFlag &= ~FLOODFLAG_LATTIA;
-
-                break;
-
-            case 8:
-                flagsChanged = true;
-                if (getJsonState(root,"water_leak"))
-                    floodFlag |= FLOODFLAG_TISKIKONE;
-                else
-                    floodFlag &= ~FLOODFLAG_TISKIKONE;
-
-                break;
-
-            case 9:
-                {
-                    float val = 0.0;
-                    enum pricelevel level;
-                    char stateStr[10];
-
-                    strcpy(stateStr,getJsonStr(root,"pricestate"));
-                    if (!strcmp(stateStr,"low")) level = low;
-                    else if (!strcmp(stateStr,"high")) level = high;
-                    else level = normal;
-                    if (getJsonFloat(root,"price",&val))
-                    {
-                        dispPrice(val,level);
-                    }
-                }
-                break;
-
-            case 10:
-                flagsChanged = true;
-                if (!getJsonState(root,"contact"))
-                    doorFlag |= DOORFLAG_FRONT;
-                else
-                    doorFlag &= ~DOORFLAG_FRONT;
-                break;
-
-            case 11:
-                {
-                    int today = -1;
-                    if (getJsonInt(root, "weekday",&today) && today == todayNum())
-                    {
-                        if (getJsonFloat(root,"avg",&avgDayPrice))
-                        {
-                            ESP_LOGI(log_tag, "--> Electricity daystats for day %d, avg %.2f", today, avgDayPrice);
-                            dispAvgPrice(avgDayPrice);
-                        }
-                    }
-                }
-                break;
-
-            default:
-                break;
+    if (batch) {
+        if (esp_mqtt_client_subscribe_multiple(client, topics, batch) < 0) {
+            ESP_LOGE(log_tag, "Subscribe failed");
         }
-        if (flagsChanged)
-        {
-            if (floodFlag) dispState(INDICATOR_ON, FLOOD);
-            else dispState(INDICATOR_OFF, FLOOD);
-
-            if (doorFlag) dispState(INDICATOR_ON, DOOR);
-            else dispState(INDICATOR_OFF, DOOR);
-        }
-        cJSON_Delete(root);
+        ++packets;
     }
-    return 0;
-}
-
-
-
-int subscribeTopic(esp_mqtt_client_handle_t client, const char *prefix, char *topic)
-{
-    char name[80];
-
-    sprintf(name,"%s/%s", prefix, topic);
-    return esp_mqtt_client_subscribe(client, name , 0);
+    ESP_LOGI(log_tag, "Subscribed %u topic filters in %u packets",
+             (unsigned)count, (unsigned)packets);
 }
 
 /*
@@ -586,20 +445,13 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
     switch ((esp_mqtt_event_id_t)event_id) {
     case MQTT_EVENT_CONNECTED:
             ESP_LOGI(log_tag, "MQTT_EVENT_CONNECTED");
-            subscribeTopic(client, hometopic, "thermostat/+/parameters/#");
-            subscribeTopic(client, hometopic, "relay/0/shellyplus1pm/state");
-            subscribeTopic(client, hometopic, "relay/+/shelly1/state");
-            subscribeTopic(client, hometopic, "elprice/currentquart");
-            subscribeTopic(client, hometopic, "elprice/daystats/#");
-            subscribeTopic(client, zigbeetopic, "#");
-            commInfo.mqtt = true;
-            dispComm(&commInfo);
+            subscribeTopics(client);
+            dispComm(LINK_MQTT, true);
         break;
 
     case MQTT_EVENT_DISCONNECTED:
         ESP_LOGI(log_tag, "MQTT_EVENT_DISCONNECTED");
-        commInfo.mqtt = false; // TODO: mqtt does not yet have any indicator.
-        dispComm(&commInfo);
+        dispComm(LINK_MQTT, false); // TODO: mqtt does not yet have any indicator.
         break;
 
     case MQTT_EVENT_SUBSCRIBED:
@@ -615,7 +467,19 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
 
     case MQTT_EVENT_DATA:
         {
-            uint16_t flags = handleJson(event, handler_args);
+            const struct mqtt_fragment frag = {
+                .topic = event->topic,
+                .topic_len = event->topic_len,
+                .msg_id = event->msg_id,
+                .data = event->data,
+                .length = event->data_len,
+                .offset = event->current_data_offset,
+                .total = event->total_data_len,
+                .time_us = esp_timer_get_time(),
+            };
+            // recorded before ingestion modifies the payload in place
+            capture_fragment(&frag, frag.time_us);
+            ingest_fragment(&frag);
         }
         break;
 
@@ -662,6 +526,463 @@ static esp_mqtt_client_handle_t mqtt_app_start(uint8_t *chipid)
     return client;
 }
 
+// Apply measurement to the display
+static void renderMeas(const struct measurement *meas)
+{
+    switch (meas->id) {
+        case COMM:
+            display_comm(&meas->data.comm);
+        break;
+
+        case TEMPERATURE:
+            display_temperature(meas->data.heater.temperature);
+        break;
+
+        case LEVEL:
+            display_level(meas->data.heater.level * 20);
+        break;
+
+        case CARHEATER:
+            display_icon(meas->data.indic, image_car, INDEX_CARHEATER);
+        break;
+
+        case OILBURNER:
+            display_icon(meas->data.indic ? INDICATOR_ON : INDICATOR_OFF, image_burner, INDEX_OILBURNER);
+        break;
+
+        case STOCKHEAT:
+            display_icon(meas->data.indic, image_heater, INDEX_STOCKHEATER);
+        break;
+
+        case SOLHEAT:
+            display_icon(meas->data.indic, image_solar, INDEX_SOLHEATER);
+        break;
+
+        case DOOR:
+            ESP_LOGI(log_tag, "Received door indicator %d", meas->data.indic);
+            display_icon(meas->data.indic ? INDICATOR_ON : INDICATOR_OFF, image_door, INDEX_DOOR);
+        break;
+
+        case FLOOD:
+            ESP_LOGI(log_tag, "Received flooding indicator %d", meas->data.indic);
+            display_icon(meas->data.indic ? INDICATOR_ON : INDICATOR_OFF, image_flood, INDEX_FLOOD);
+        break;
+
+        case TIME:
+            display_time(&meas->data.time);
+        break;
+
+        case PRICE:
+            display_price(&meas->data.price, 10, 230 );
+        break;
+
+        case AVGPRICE:
+            display_price(&meas->data.price, 160, 230 );
+
+    }
+}
+
+#if RENDER_LANES
+// Changed latest values not yet rendered, bit n is measurement type n
+static uint32_t lanesPending(void)
+{
+#if RENDER_INPUT == RENDER_INPUT_STATE
+    return state_changed(&shown);
+#else
+    return mailbox_pending();
+#endif
+}
+
+// Wait until a latest value changes
+static bool lanesWait(TickType_t timeout)
+{
+#if RENDER_INPUT == RENDER_INPUT_STATE
+    return state_wait(timeout);
+#else
+    return mailbox_wait(timeout);
+#endif
+}
+
+// Take changed latest values of the given types, values are indexed by
+// measurement type
+static uint32_t lanesTake(uint32_t types, struct measurement **values)
+{
+#if RENDER_INPUT == RENDER_INPUT_STATE
+    *values = shown.values;
+    return state_snapshot(&shown, types);
+#else
+    static struct measurement slots[MAILBOX_SLOTS];
+    *values = slots;
+    return mailbox_take(slots, types);
+#endif
+}
+#endif
+
+// Render task: owns the display, renders queued measurements
+static void renderTask(void *arg)
+{
+    display_init();
+    display_static_elements();
+    display_indicatoramount(6);
+
+    // frame scheduler: collect updates until the next frame tick, then
+    // render them all at once
+    const TickType_t frameTicks = pdMS_TO_TICKS(1000 / FRAME_RATE_HZ);
+    TickType_t lastFrame = xTaskGetTickCount();
+    int64_t worstLatency = 0;
+#if RENDER_LANES
+    const TickType_t cosmeticTicks = pdMS_TO_TICKS(COSMETIC_PERIOD_MS);
+    TickType_t lastCosmetic = lastFrame - cosmeticTicks;
+#else
+    // measurements of the frame, traced after the flush
+    static struct measurement traced[FRAME_TRACE_MAX];
+#endif
+
+    display_set_compose(true);
+    while (1)
+    {
+        bool urgent = false;
+#if RENDER_LANES
+        // pending cosmetic updates wait for their period, not for a post
+        TickType_t timeout = 10000 / portTICK_PERIOD_MS;
+        const uint32_t pending = lanesPending();
+        if (pending & ~MAILBOX_COSMETIC)
+        {
+            timeout = 0;
+        }
+        else if (pending)
+        {
+            const TickType_t sinceCosmetic = xTaskGetTickCount() - lastCosmetic;
+            timeout = sinceCosmetic < cosmeticTicks ? cosmeticTicks - sinceCosmetic : 0;
+        }
+        if (timeout && !lanesWait(timeout) && !lanesPending())
+#elif RENDER_INPUT == RENDER_INPUT_RING
+        // sleep only if no producer posted after the previous frame
+        bool idle = true;
+        for (int i = 0; i < RENDER_RING_PRODUCERS; ++i)
+        {
+            idle &= spsc_ring_idle(&renderRings[i].ring);
+        }
+        if (idle && !ulTaskNotifyTake(pdTRUE, 10000 / portTICK_PERIOD_MS))
+#else
+        struct measurement meas;
+
+        if (!xQueueReceive(evt_queue, &meas, 10000 / portTICK_PERIOD_MS))
+#endif
+        {
+            ESP_LOGI(log_tag,"timeout");
+            continue;
+        }
+
+#if RENDER_LANES
+        // alarms skip the frame scheduler
+        urgent = lanesPending() & MAILBOX_ALARMS;
+#endif
+        const TickType_t sinceFrame = xTaskGetTickCount() - lastFrame;
+        if (!urgent && sinceFrame < frameTicks)
+        {
+            vTaskDelay(frameTicks - sinceFrame);
+        }
+
+#if RENDER_LANES
+        // updates posted while waiting for the frame are taken too
+        struct measurement *slots;
+        uint32_t types = MAILBOX_ALARMS | MAILBOX_STATES;
+        if (xTaskGetTickCount() - lastCosmetic >= cosmeticTicks)
+        {
+            types |= MAILBOX_COSMETIC;
+        }
+#if RENDER_INPUT == RENDER_INPUT_STATE
+        // a redraw is a projection of the whole state
+        const bool redraw = __atomic_exchange_n(&redrawPending, false, __ATOMIC_RELAXED);
+        if (redraw)
+        {
+            types = STATE_ALL;
+        }
+        const uint32_t fresh = lanesTake(types, &slots);
+        uint32_t taken = fresh;
+        if (redraw)
+        {
+            display_invalidate();
+            display_static_elements();
+            for (int id = 0; id < STATE_FIELDS; ++id)
+            {
+                if (shown.versions[id]) taken |= STATE_BIT(id);
+            }
+        }
+#else
+        const uint32_t taken = lanesTake(types, &slots);
+        const uint32_t fresh = taken;
+#endif
+        if (!taken)
+        {
+            continue;
+        }
+        if (taken & MAILBOX_COSMETIC)
+        {
+            lastCosmetic = xTaskGetTickCount();
+        }
+        const int64_t dequeued = esp_timer_get_time();
+        int64_t oldest = INT64_MAX;
+        uint32_t depth = 0;
+        for (int lane = 0; lane < MAILBOX_LANES; ++lane)
+        {
+            for (uint32_t bits = taken & mailbox_lanes[lane]; bits; bits &= bits - 1)
+            {
+                const int id = __builtin_ctz(bits);
+                struct measurement *meas = &slots[id];
+                if (fresh & MAILBOX_BIT(id))
+                {
+                    if (meas->queued_us < oldest) oldest = meas->queued_us;
+                    meas->dequeued_us = dequeued;
+                    meas->rendered_us = esp_timer_get_time();
+                    ++depth;
+                }
+                renderMeas(meas);
+            }
+        }
+#elif RENDER_INPUT == RENDER_INPUT_RING
+        int64_t oldest = INT64_MAX;
+        uint32_t depth = 0;
+        for (int i = 0; i < RENDER_RING_PRODUCERS; ++i)
+        {
+            struct measurement meas;
+            while (spsc_ring_pop(&renderRings[i].ring, &meas))
+            {
+                if (meas.queued_us < oldest) oldest = meas.queued_us;
+                meas.dequeued_us = meas.rendered_us = esp_timer_get_time();
+                renderMeas(&meas);
+                if (depth < FRAME_TRACE_MAX) traced[depth] = meas;
+                ++depth;
+            }
+        }
+        if (!depth)
+        {
+            continue;
+        }
+#else
+        int64_t oldest = meas.queued_us;
+        uint32_t depth = 0;
+        do
+        {
+            if (meas.queued_us < oldest) oldest = meas.queued_us;
+            meas.dequeued_us = meas.rendered_us = esp_timer_get_time();
+            renderMeas(&meas);
+            if (depth < FRAME_TRACE_MAX) traced[depth] = meas;
+            ++depth;
+        } while (xQueueReceive(evt_queue, &meas, 0));
+#endif
+
+        display_flush();
+        lastFrame = xTaskGetTickCount();
+
+        const int64_t flushed = esp_timer_get_time();
+#if RENDER_LANES
+        for (int lane = 0; lane < MAILBOX_LANES; ++lane)
+        {
+            // redrawn values are not traced again
+            for (uint32_t bits = fresh & mailbox_lanes[lane]; bits; bits &= bits - 1)
+            {
+                struct measurement *meas = &slots[__builtin_ctz(bits)];
+                const uint32_t us = flushed - meas->queued_us;
+                ++laneLatency[lane].count;
+                laneLatency[lane].total_us += us;
+                if (us > laneLatency[lane].max_us) laneLatency[lane].max_us = us;
+                meas->flushed_us = flushed;
+                trace_record(meas);
+            }
+        }
+#else
+        for (uint32_t i = 0; i < depth && i < FRAME_TRACE_MAX; ++i)
+        {
+            traced[i].flushed_us = flushed;
+            trace_record(&traced[i]);
+        }
+#endif
+        trace_batch(depth);
+        const int64_t latency = flushed - oldest;
+        if (depth && latency > worstLatency)
+        {
+            worstLatency = latency;
+            ESP_LOGI(log_tag, "worst input to pixel latency %lld us", worstLatency);
+        }
+    }
+}
+
+#if RENDER_LANES
+// Log queued to flushed latency of the priority lanes
+static void logLaneLatency(void)
+{
+    static const char *const names[MAILBOX_LANES] = { "alarm", "state", "cosmetic" };
+
+    for (int lane = 0; lane < MAILBOX_LANES; ++lane)
+    {
+        const uint32_t count = laneLatency[lane].count;
+        ESP_LOGI(log_tag, "%s latency: %lu rendered, %llu us avg, %lu us max",
+                 names[lane], (unsigned long)count,
+                 count ? (unsigned long long)(laneLatency[lane].total_us / count) : 0ULL,
+                 (unsigned long)laneLatency[lane].max_us);
+    }
+}
+
+#if RENDER_INPUT == RENDER_INPUT_MAILBOX
+// Log mailbox posts and the overwrites of every measurement type
+static void logMailboxStats(void)
+{
+    struct mailbox_stats stats;
+    char types[MAILBOX_SLOTS * 12] = "";
+    size_t length = 0;
+    uint32_t total = 0;
+
+    mailbox_stats(&stats);
+    for (int id = 0; id < MAILBOX_SLOTS; ++id)
+    {
+        total += stats.overwritten[id];
+        if (stats.overwritten[id] && length < sizeof(types))
+        {
+            length += snprintf(types + length, sizeof(types) - length, " %d:%lu",
+                               id, (unsigned long)stats.overwritten[id]);
+        }
+    }
+    ESP_LOGI(log_tag, "mailbox: %lu posted, %lu overwritten (type:count%s)",
+             (unsigned long)stats.posted, (unsigned long)total, types);
+}
+#endif
+
+// Console: post a burst of cosmetic and state updates with an alarm every
+// FLOOD_ALARM_EVERY posts, then report the latency of every lane
+static int cmdFlood(int argc, char **argv)
+{
+    const int count = argc > 1 ? atoi(argv[1]) : 2000;
+    const int perTick = argc > 2 ? atoi(argv[2]) : 20;
+    static const enum meastype filler[] = { TEMPERATURE, PRICE, AVGPRICE, LEVEL };
+    static const enum meastype flooded[] = { DOOR, FLOOD, TEMPERATURE, PRICE, AVGPRICE, LEVEL };
+    struct measurement saved[sizeof(flooded) / sizeof(flooded[0])];
+    bool written[sizeof(flooded) / sizeof(flooded[0])];
+
+    // real values are posted again afterwards, sensors may not report soon
+    // and their unchanged payloads are dropped by the dedup
+    for (size_t i = 0; i < sizeof(flooded) / sizeof(flooded[0]); ++i)
+    {
+        written[i] = state_get(flooded[i], &saved[i]);
+    }
+    memset(laneLatency, 0, sizeof(laneLatency));
+    for (int i = 0; i < count; ++i)
+    {
+        struct measurement meas = { 0 };
+        if (i % FLOOD_ALARM_EVERY == 0)
+        {
+            meas.id = (i / FLOOD_ALARM_EVERY) & 1 ? FLOOD : DOOR;
+            meas.data.indic = (i / FLOOD_ALARM_EVERY / 2) & 1 ? INDICATOR_ON : INDICATOR_OFF;
+        }
+        else
+        {
+            meas.id = filler[i % 4];
+            if (meas.id == LEVEL)
+            {
+                meas.data.heater.level = i % 5;
+            }
+            else if (meas.id == TEMPERATURE)
+            {
+                meas.data.heater.temperature = i % 100;
+            }
+            else
+            {
+                meas.data.price.euros = i % 100;
+                meas.data.price.level = normal;
+            }
+        }
+        postMeas(&meas);
+        if (perTick > 0 && i % perTick == perTick - 1)
+        {
+            vTaskDelay(1);
+        }
+    }
+    vTaskDelay(pdMS_TO_TICKS(2 * COSMETIC_PERIOD_MS));
+    logLaneLatency();
+
+    for (size_t i = 0; i < sizeof(flooded) / sizeof(flooded[0]); ++i)
+    {
+        // a zero value never received would be shown, e.g. the average
+        // price before the first daystats
+        if (!written[i])
+        {
+            continue;
+        }
+        // traced as posted now
+        struct measurement meas = { .id = flooded[i], .data = saved[i].data };
+        postMeas(&meas);
+    }
+    return 0;
+}
+#endif
+
+#if RENDER_INPUT == RENDER_INPUT_STATE
+// Console: repaint the screen from the state store
+static int cmdRedraw(int argc, char **argv)
+{
+    __atomic_store_n(&redrawPending, true, __ATOMIC_RELAXED);
+    xTaskNotifyGive(renderHandle);
+    return 0;
+}
+#endif
+
+// Console: print the latency trace, or clear it
+static int cmdStats(int argc, char **argv)
+{
+    if (argc > 1)
+    {
+        if (strcmp(argv[1], "reset"))
+        {
+            printf("usage: stats [reset]\n");
+            return 1;
+        }
+        trace_reset();
+        return 0;
+    }
+    trace_print();
+    return 0;
+}
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY && CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+// Log CPU time used by every task since the previous call
+static void logTaskStats(void)
+{
+    static struct {
+        UBaseType_t number;
+        configRUN_TIME_COUNTER_TYPE runtime;
+    } prev[TASK_STATS_MAX];
+    static configRUN_TIME_COUNTER_TYPE prevTotal;
+    TaskStatus_t tasks[TASK_STATS_MAX];
+    configRUN_TIME_COUNTER_TYPE total;
+
+    const UBaseType_t count = uxTaskGetSystemState(tasks, TASK_STATS_MAX, &total);
+    const configRUN_TIME_COUNTER_TYPE elapsed = total - prevTotal;
+
+    // percentage is relative to one core
+    ESP_LOGI(log_tag, "task cpu time for last %lu ms", (unsigned long)(elapsed / 1000));
+    for (UBaseType_t i = 0; i < count; i++)
+    {
+        configRUN_TIME_COUNTER_TYPE before = 0;
+        for (int j = 0; j < TASK_STATS_MAX; j++)
+        {
+            if (prev[j].number == tasks[i].xTaskNumber) before = prev[j].runtime;
+        }
+        const configRUN_TIME_COUNTER_TYPE used = tasks[i].ulRunTimeCounter - before;
+        const BaseType_t core = xTaskGetCoreID(tasks[i].xHandle);
+        ESP_LOGI(log_tag, "  %-16s core %d %8lu us %5.1f%%", tasks[i].pcTaskName,
+                 core == tskNO_AFFINITY ? -1 : (int)core, (unsigned long)used,
+                 elapsed ? 100.0 * used / elapsed : 0.0);
+    }
+    for (int j = 0; j < TASK_STATS_MAX; j++)
+    {
+        prev[j].number = j < count ? tasks[j].xTaskNumber : 0;
+        prev[j].runtime = j < count ? tasks[j].ulRunTimeCounter : 0;
+    }
+    prevTotal = total;
+}
+#endif
+
 // Entry point
 void app_main(void)
 {
@@ -683,15 +1004,32 @@ void app_main(void)
     setenv("TZ", "GMT-2", 1);
     tzset();
 
+    // queue must exist before any event handler posts to it, the store
+    // before the render task reads it
+    state_init();
+#if RENDER_INPUT == RENDER_INPUT_STATE
+    xTaskCreatePinnedToCore(renderTask, "render", RENDER_TASK_STACK, NULL,
+                            RENDER_TASK_PRIORITY, &renderHandle, RENDER_TASK_CORE);
+    state_set_reader(renderHandle);
+#endif
+#if RENDER_INPUT == RENDER_INPUT_MAILBOX
+    TaskHandle_t renderHandle;
+    xTaskCreatePinnedToCore(renderTask, "render", RENDER_TASK_STACK, NULL,
+                            RENDER_TASK_PRIORITY, &renderHandle, RENDER_TASK_CORE);
+    mailbox_init(renderHandle);
+#elif RENDER_INPUT == RENDER_INPUT_RING
+    xTaskCreatePinnedToCore(renderTask, "render", RENDER_TASK_STACK, NULL,
+                            RENDER_TASK_PRIORITY, &renderHandle, RENDER_TASK_CORE);
+#elif RENDER_INPUT == RENDER_INPUT_QUEUE
+    evt_queue = xQueueCreate(15, sizeof(struct measurement));
+    xTaskCreatePinnedToCore(renderTask, "render", RENDER_TASK_STACK, NULL,
+                            RENDER_TASK_PRIORITY, NULL, RENDER_TASK_CORE);
+#endif
+
     //bme280_init();
-    display_init();
     ESP_ERROR_CHECK(nvs_flash_init());
     wifi_init();
 
-    evt_queue = xQueueCreate(15, sizeof(struct measurement));
-
-    display_static_elements();
-    display_indicatoramount(6);
     dispLevel(0);
     dispTemperature(0);
     dispPrice(0,normal);
@@ -704,74 +1042,87 @@ void app_main(void)
 
     on_clock_tick(chipid); // chipid is not used.
 
+    ingest_init(postMeas, esp_timer_get_time);
+    capture_init(true);
     esp_mqtt_client_handle_t client = mqtt_app_start(chipid);
     // register periodic timer
     ESP_ERROR_CHECK(esp_timer_create(&ptimer_args, &ptimer_handle));
-    ESP_ERROR_CHECK(esp_timer_start_periodic(ptimer_handle, 5000000)); // 5 sec
+    ESP_ERROR_CHECK(esp_timer_start_periodic(ptimer_handle, CLOCK_TICK_US));
 
     ESP_LOGI(log_tag, "Initialization completed");
+    console_start();
+#if RENDER_LANES
+    console_register("flood", "[count] [per_tick]",
+                     "Post synthetic measurements with alarms in between and report "
+                     "lane latency; indicators show test values until the next update",
+                     cmdFlood);
+#endif
+#if RENDER_INPUT == RENDER_INPUT_STATE
+    console_register("redraw", NULL, "Repaint the screen from the current state",
+                     cmdRedraw);
+#endif
+    console_register("stats", "[reset]",
+                     "Print latency histograms from MQTT receive to flush and "
+                     "render input counters",
+                     cmdStats);
+    static char statsJson[STATS_JSON_MAX];
 
     while (1)
     {
-        struct measurement meas;
-
-        if (xQueueReceive(evt_queue, &meas, 10000 / portTICK_PERIOD_MS))
+        vTaskDelay(pdMS_TO_TICKS(STATS_PERIOD_MS));
+        struct ingest_stats msgs;
+        ingest_stats(&msgs);
+        const uint32_t relevant = msgs.received - msgs.ignored;
+        ESP_LOGI(log_tag, "mqtt messages: %lu received, %lu relevant (%.1f%%), %lu parsed, %lu routed, %lu measurements",
+                 (unsigned long)msgs.received, (unsigned long)relevant,
+                 msgs.received ? 100.0 * relevant / msgs.received : 100.0,
+                 (unsigned long)msgs.parsed, (unsigned long)msgs.routed,
+                 (unsigned long)msgs.emitted);
+        const uint32_t deduped = msgs.duplicates + msgs.unchanged;
+        ESP_LOGI(log_tag, "dedup: %lu identical, %lu unchanged, %.1f%% hit rate",
+                 (unsigned long)msgs.duplicates, (unsigned long)msgs.unchanged,
+                 relevant ? 100.0 * deduped / relevant : 0.0);
+        struct json_arena_stats arena;
+        json_arena_stats(&arena);
+        ESP_LOGI(log_tag, "json arena: %u/%u bytes high water, %lu heap allocations",
+                 (unsigned)arena.high_water, (unsigned)JSON_ARENA_SIZE,
+                 (unsigned long)arena.heap_allocs);
+        struct reassembly_stats reasm;
+        reassembly_stats(&reasm);
+        ESP_LOGI(log_tag, "fragmented payloads: %lu, %lu completed, %lu dropped, %lu oversize, %lu long topic",
+                 (unsigned long)reasm.fragmented, (unsigned long)reasm.completed,
+                 (unsigned long)reasm.dropped, (unsigned long)reasm.oversize,
+                 (unsigned long)reasm.long_topic);
+#if RENDER_INPUT == RENDER_INPUT_MAILBOX
+        logMailboxStats();
+#endif
+#if RENDER_LANES
+        logLaneLatency();
+#endif
+        struct state_stats store;
+        state_stats(&store);
+        ESP_LOGI(log_tag, "state store: %lu writes, %lu unchanged, %lu replaced, %lu snapshot retries",
+                 (unsigned long)store.writes, (unsigned long)store.unchanged,
+                 (unsigned long)store.replaced, (unsigned long)store.retries);
+        const struct trace_queue *frames = trace_queue_stats();
+        ESP_LOGI(log_tag, "render: %lu frames, %.1f measurements avg, %lu max, %lu dropped",
+                 (unsigned long)frames->batches,
+                 frames->batches ? (double)frames->taken / frames->batches : 0.0,
+                 (unsigned long)frames->depth_max, (unsigned long)frames->full);
+        const size_t statsLen = trace_json(statsJson, sizeof(statsJson));
+        if (statsLen && esp_mqtt_client_publish(client, STATS_TOPIC, statsJson,
+                                                statsLen, 0, 0) < 0)
         {
-            switch (meas.id) {
-                case COMM:
-                    display_comm(&meas.data.comm);
-                break;
-
-                case TEMPERATURE:
-                    display_temperature(meas.data.heater.temperature);
-                break;
-
-                case LEVEL:
-                    display_level(meas.data.heater.level * 20);
-                break;
-
-                case CARHEATER:
-                    display_icon(meas.data.indic, image_car, INDEX_CARHEATER);
-                break;
-
-                case OILBURNER:
-                    display_icon(meas.data.indic ? INDICATOR_ON : INDICATOR_OFF, image_burner, INDEX_OILBURNER);
-                break;
-
-                case STOCKHEAT:
-                    display_icon(meas.data.indic, image_heater, INDEX_STOCKHEATER);
-                break;
-
-                case SOLHEAT:
-                    display_icon(meas.data.indic, image_solar, INDEX_SOLHEATER);
-                break;
-
-                case DOOR:
-                    ESP_LOGI(log_tag, "Received door indicator %d", meas.data.indic);
-                    display_icon(meas.data.indic ? INDICATOR_ON : INDICATOR_OFF, image_door, INDEX_DOOR);
-                break;
-
-                case FLOOD:
-                    ESP_LOGI(log_tag, "Received flooding indicator %d", meas.data.indic);
-                    display_icon(meas.data.indic ? INDICATOR_ON : INDICATOR_OFF, image_flood, INDEX_FLOOD);
-                break;
-
-                case TIME:
-                    display_time(&meas.data.time);
-                break;
-
-                case PRICE:
-                    display_price(&meas.data.price, 10, 230 );
-                break;
-
-                case AVGPRICE:
-                    display_price(&meas.data.price, 160, 230 );
-
-            }    
-        }
-        else
-        { 
-            ESP_LOGI(log_tag,"timeout");
+            ESP_LOGD(log_tag, "stats not published");
         }
+        struct capture_stats capture;
+        capture_stats(&capture);
+        ESP_LOGI(log_tag, "capture: %lu records, %u/%u bytes, %lu evicted, %lu missed",
+                 (unsigned long)capture.records, (unsigned)capture.used,
+                 (unsigned)CAPTURE_RING_SIZE, (unsigned long)capture.evicted,
+                 (unsigned long)capture.missed);
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY && CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+        logTaskStats();
+#endif
     }
 }
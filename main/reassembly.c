@@ -0,0 +1,159 @@
+// SPDX-License-Identifier: MIT
+// Reassembly of MQTT payloads delivered in several data events.
+
+#include "reassembly.h"
+
+#include <string.h>
+
+// Payload being reassembled
+struct slot {
+    bool used;
+    bool discard; // remaining fragments are skipped
+    int msg_id;
+    int tag;
+    size_t received; // bytes received so far
+    size_t total;
+    uint32_t start;  // age stamp, the oldest slot is evicted
+    int64_t time_us; // receive time of the first fragment
+    size_t topic_len;
+    char topic[REASSEMBLY_TOPIC_SIZE];
+    char data[REASSEMBLY_PAYLOAD_SIZE];
+};
+
+static struct slot slots[REASSEMBLY_SLOTS];
+static uint32_t age_clock;
+static struct reassembly_stats stats;
+
+static struct slot* find_slot(int msg_id)
+{
+    for (size_t i = 0; i < REASSEMBLY_SLOTS; ++i) {
+        if (slots[i].used && slots[i].msg_id == msg_id) {
+            return &slots[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Get free slot, evict the oldest incomplete payload if none.
+ */
+static struct slot* alloc_slot(void)
+{
+    struct slot* oldest = &slots[0];
+    for (size_t i = 0; i < REASSEMBLY_SLOTS; ++i) {
+        if (!slots[i].used) {
+            return &slots[i];
+        }
+        if (slots[i].start < oldest->start) {
+            oldest = &slots[i];
+        }
+    }
+    if (!oldest->discard) {
+        ++stats.dropped;
+    }
+    oldest->used = false;
+    return oldest;
+}
+
+static enum reassembly_result first_fragment(const struct mqtt_fragment* frag,
+                                             int tag)
+{
+    // a stale payload with the same id is replaced
+    struct slot* slot = find_slot(frag->msg_id);
+    if (slot) {
+        if (!slot->discard) {
+            ++stats.dropped;
+        }
+        slot->used = false;
+    } else {
+        slot = alloc_slot();
+    }
+
+    ++stats.fragmented;
+    slot->used = true;
+    slot->msg_id = frag->msg_id;
+    slot->tag = tag;
+    slot->total = frag->total;
+    slot->received = frag->length;
+    slot->start = ++age_clock;
+    slot->time_us = frag->time_us;
+    slot->discard = tag < 0;
+
+    if (frag->total > REASSEMBLY_PAYLOAD_SIZE) {
+        ++stats.oversize;
+        slot->discard = true;
+    }
+    // a truncated topic could match another route
+    if (!slot->discard && frag->topic_len > REASSEMBLY_TOPIC_SIZE) {
+        ++stats.long_topic;
+        slot->discard = true;
+    }
+    if (!slot->discard) {
+        slot->topic_len = frag->topic_len;
+        memcpy(slot->topic, frag->topic, slot->topic_len);
+        memcpy(slot->data, frag->data, frag->length);
+    }
+    return slot->discard ? REASSEMBLY_DISCARDED : REASSEMBLY_PENDING;
+}
+
+enum reassembly_result reassembly_feed(const struct mqtt_fragment* frag,
+                                       int tag, struct mqtt_payload* payload)
+{
+    // whole payload in one event, no copy
+    if (frag->offset == 0 && frag->length >= frag->total) {
+        if (tag < 0) {
+            return REASSEMBLY_DISCARDED;
+        }
+        payload->topic = frag->topic;
+        payload->topic_len = frag->topic_len;
+        payload->data = frag->data;
+        payload->length = frag->length;
+        payload->tag = tag;
+        payload->time_us = frag->time_us;
+        return REASSEMBLY_COMPLETE;
+    }
+
+    if (frag->offset == 0) {
+        return first_fragment(frag, tag);
+    }
+
+    struct slot* slot = find_slot(frag->msg_id);
+    if (!slot) {
+        // first fragment was evicted or never seen
+        return REASSEMBLY_DISCARDED;
+    }
+    if (slot->discard) {
+        if (frag->offset + frag->length >= slot->total) {
+            slot->used = false;
+        }
+        return REASSEMBLY_DISCARDED;
+    }
+    if (frag->offset != slot->received ||
+        frag->offset + frag->length > slot->total) {
+        ++stats.dropped;
+        slot->used = false;
+        return REASSEMBLY_DISCARDED;
+    }
+
+    memcpy(&slot->data[slot->received], frag->data, frag->length);
+    slot->received += frag->length;
+    if (slot->received < slot->total) {
+        return REASSEMBLY_PENDING;
+    }
+
+    // slot is free for reuse, its buffer stays valid until the next call
+    ++stats.completed;
+    slot->used = false;
+    payload->topic = slot->topic;
+    payload->topic_len = slot->topic_len;
+    payload->data = slot->data;
+    payload->length = slot->total;
+    payload->tag = slot->tag;
+    payload->time_us = slot->time_us;
+    return REASSEMBLY_COMPLETE;
+}
+
+void reassembly_stats(struct reassembly_stats* out)
+{
+    *out = stats;
+}
@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: MIT
+// Reassembly of MQTT payloads delivered in several data events.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Number of payloads reassembled at the same time
+#ifndef REASSEMBLY_SLOTS
+#define REASSEMBLY_SLOTS 2
+#endif
+
+// Max size of a reassembled payload, allocated statically per slot
+#ifndef REASSEMBLY_PAYLOAD_SIZE
+#define REASSEMBLY_PAYLOAD_SIZE 4096
+#endif
+
+// Max topic length kept for a reassembled payload
+#ifndef REASSEMBLY_TOPIC_SIZE
+#define REASSEMBLY_TOPIC_SIZE 128
+#endif
+
+/**
+ * One data event: the whole payload or a fragment of it. Topic is set in
+ * the first fragment only.
+ */
+struct mqtt_fragment {
+    const char* topic;
+    size_t topic_len;
+    int msg_id;
+    char* data;
+    size_t length;
+    size_t offset; // offset of data in the payload
+    size_t total;  // payload size
+    int64_t time_us; // receive time
+};
+
+/**
+ * Complete payload.
+ */
+struct mqtt_payload {
+    const char* topic;
+    size_t topic_len;
+    char* data; // mutable, valid until the next reassembly_feed call
+    size_t length;
+    int tag;    // tag given with the first fragment
+    int64_t time_us; // receive time of the first fragment
+};
+
+enum reassembly_result {
+    REASSEMBLY_COMPLETE,  // payload is ready
+    REASSEMBLY_PENDING,   // waiting for more fragments
+    REASSEMBLY_DISCARDED, // unwanted, oversize or broken payload, or a topic
+                          // too long to keep
+};
+
+/**
+ * Reassembly statistics.
+ */
+struct reassembly_stats {
+    uint32_t fragmented; // payloads delivered in several events
+    uint32_t completed;  // fragmented payloads reassembled
+    uint32_t dropped;    // fragmented payloads lost: out of order or evicted
+    uint32_t oversize;   // payloads larger than REASSEMBLY_PAYLOAD_SIZE
+    uint32_t long_topic; // topics longer than REASSEMBLY_TOPIC_SIZE
+};
+
+/**
+ * Feed data event. Unfragmented payloads are returned in place without a
+ * copy, fragments are collected in a slot keyed by msg_id.
+ * @param frag data event
+ * @param tag caller defined tag of the payload, given with the first
+ *        fragment, negative to discard the payload
+ * @param payload output payload if complete
+ * @return reassembly result
+ */
+enum reassembly_result reassembly_feed(const struct mqtt_fragment* frag,
+                                       int tag, struct mqtt_payload* payload);
+
+/**
+ * Get reassembly statistics.
+ * @param stats output statistics
+ */
+void reassembly_stats(struct reassembly_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: MIT
+// Lock-free single producer, single consumer ring of measurements.
+
+#pragma once
+
+#include "display.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Number of entries, power of 2
+#ifndef SPSC_RING_SIZE
+#define SPSC_RING_SIZE 16
+#endif
+
+// Producer and consumer indices are kept on separate cache lines
+#ifndef SPSC_CACHE_LINE
+#define SPSC_CACHE_LINE 64
+#endif
+
+/**
+ * Ring buffer. Indices run freely and wrap at 2^32. Each side keeps a copy
+ * of the other side's index and reads the shared one only when its copy
+ * says the ring is full or empty.
+ */
+struct spsc_ring {
+    // producer side
+    uint32_t head __attribute__((aligned(SPSC_CACHE_LINE)));
+    uint32_t tail_seen;
+    // consumer side
+    uint32_t tail __attribute__((aligned(SPSC_CACHE_LINE)));
+    uint32_t head_seen;
+    struct measurement items[SPSC_RING_SIZE]
+        __attribute__((aligned(SPSC_CACHE_LINE)));
+};
+
+/**
+ * Initialize empty ring.
+ * @param ring ring to initialize
+ */
+static inline void spsc_ring_init(struct spsc_ring* ring)
+{
+    ring->head = ring->tail_seen = 0;
+    ring->tail = ring->head_seen = 0;
+}
+
+/**
+ * Append measurement, called by the producer only.
+ * @param ring ring instance
+ * @param meas measurement to copy
+ * @param wake output, true if the consumer may have found the ring empty
+ *        and has to be woken up
+ * @return false if the ring is full
+ */
+static inline bool spsc_ring_push(struct spsc_ring* ring,
+                                  const struct measurement* meas, bool* wake)
+{
+    const uint32_t head = ring->head;
+    if (head - ring->tail_seen == SPSC_RING_SIZE) {
+        ring->tail_seen = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        if (head - ring->tail_seen == SPSC_RING_SIZE) {
+            *wake = false;
+            return false;
+        }
+    }
+    ring->items[head & (SPSC_RING_SIZE - 1)] = *meas;
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+    // pairs with the fence in spsc_ring_idle: either the consumer sees the
+    // new entry or the producer sees that everything before it was taken
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    *wake = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED) == head;
+    return true;
+}
+
+/**
+ * Take the oldest measurement, called by the consumer only.
+ * @param ring ring instance
+ * @param meas output measurement
+ * @return false if the ring is empty
+ */
+static inline bool spsc_ring_pop(struct spsc_ring* ring,
+                                 struct measurement* meas)
+{
+    const uint32_t tail = ring->tail;
+    if (tail == ring->head_seen) {
+        ring->head_seen = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        if (tail == ring->head_seen) {
+            return false;
+        }
+    }
+    *meas = ring->items[tail & (SPSC_RING_SIZE - 1)];
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * Check before the consumer goes to sleep that the ring is still empty.
+ * @param ring ring instance
+ * @return true if nothing was pushed, a later push will request a wakeup
+ */
+static inline bool spsc_ring_idle(struct spsc_ring* ring)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == ring->tail;
+}
+
+#ifdef __cplusplus
+}
+#endif
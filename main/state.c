@@ -0,0 +1,247 @@
+// SPDX-License-Identifier: MIT
+// Home state store with seqlock snapshots.
+
+#include "state.h"
+
+#include <string.h>
+
+static struct measurement values[STATE_FIELDS];
+static uint32_t versions[STATE_FIELDS];
+// odd while a write is in progress
+static uint32_t sequence;
+// fields changed since the reader took them, the reader is notified when
+// a bit is set
+static uint32_t unread;
+static TaskHandle_t reader;
+static struct state_stats stats;
+// writers run on both cores
+static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * Compare the fields of a measurement type shown on the display.
+ */
+static bool same_value(const struct measurement* a, const struct measurement* b)
+{
+    switch (a->id) {
+    case COMM:
+        return a->data.comm.wifi == b->data.comm.wifi &&
+            a->data.comm.ntp == b->data.comm.ntp &&
+            a->data.comm.mqtt == b->data.comm.mqtt;
+    case TEMPERATURE:
+        return a->data.heater.temperature == b->data.heater.temperature;
+    case LEVEL:
+        return a->data.heater.level == b->data.heater.level;
+    case TIME:
+        return a->data.time.hours == b->data.time.hours &&
+            a->data.time.minutes == b->data.time.minutes &&
+            (!DISPLAY_SECONDS || a->data.time.seconds == b->data.time.seconds);
+    case PRICE:
+    case AVGPRICE:
+        return a->data.price.level == b->data.price.level &&
+            a->data.price.euros == b->data.price.euros;
+    default:
+        return a->data.indic == b->data.indic;
+    }
+}
+
+// Called with the lock held
+static void begin_write(void)
+{
+    __atomic_store_n(&sequence, sequence + 1, __ATOMIC_RELAXED);
+    // field writes are not visible before the odd sequence
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+// Called with the lock held
+static void end_write(void)
+{
+    __atomic_store_n(&sequence, sequence + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Publish a changed field, called with the lock held and a write in
+ * progress.
+ * @return true if the previous change was not taken yet
+ */
+static bool commit(enum meastype type)
+{
+    const uint32_t bit = STATE_BIT(type);
+
+    __atomic_store_n(&versions[type], versions[type] + 1, __ATOMIC_RELAXED);
+    end_write();
+    // pairs with the clear in state_snapshot: either the reader sees the
+    // new version or this write sees the bit cleared and notifies
+    const bool replaced = __atomic_fetch_or(&unread, bit, __ATOMIC_SEQ_CST) & bit;
+    if (replaced) {
+        ++stats.replaced;
+    }
+    return replaced;
+}
+
+void state_init(void)
+{
+    portENTER_CRITICAL(&lock);
+    begin_write();
+    memset(values, 0, sizeof(values));
+    for (int type = 0; type < STATE_FIELDS; ++type) {
+        values[type].id = type;
+        versions[type] = 0;
+    }
+    end_write();
+    unread = 0;
+    memset(&stats, 0, sizeof(stats));
+    reader = NULL;
+    portEXIT_CRITICAL(&lock);
+}
+
+void state_set_reader(TaskHandle_t consumer)
+{
+    bool pending;
+
+    // a writer commits either before this and its change is pending here,
+    // or after this and it sees the reader
+    portENTER_CRITICAL(&lock);
+    reader = consumer;
+    pending = unread != 0;
+    portEXIT_CRITICAL(&lock);
+
+    if (pending && consumer) {
+        xTaskNotifyGive(consumer);
+    }
+}
+
+bool state_set(const struct measurement* meas)
+{
+    const enum meastype type = meas->id;
+    bool changed;
+    bool replaced = false;
+
+    portENTER_CRITICAL(&lock);
+    ++stats.writes;
+    changed = !versions[type] || !same_value(&values[type], meas);
+    if (changed) {
+        begin_write();
+        values[type] = *meas;
+        replaced = commit(type);
+    } else {
+        ++stats.unchanged;
+    }
+    portEXIT_CRITICAL(&lock);
+
+    if (changed && !replaced && reader) {
+        xTaskNotifyGive(reader);
+    }
+    return replaced;
+}
+
+struct measurement* state_write_begin(enum meastype type)
+{
+    portENTER_CRITICAL(&lock);
+    ++stats.writes;
+    begin_write();
+    return &values[type];
+}
+
+void state_write_end(enum meastype type, bool changed)
+{
+    bool replaced = false;
+
+    if (changed) {
+        replaced = commit(type);
+    } else {
+        end_write();
+        ++stats.unchanged;
+    }
+    portEXIT_CRITICAL(&lock);
+
+    if (changed && !replaced && reader) {
+        xTaskNotifyGive(reader);
+    }
+}
+
+bool state_wait(TickType_t timeout)
+{
+    return ulTaskNotifyTake(pdTRUE, timeout) != 0;
+}
+
+bool state_get(enum meastype type, struct measurement* meas)
+{
+    uint32_t begin;
+    uint32_t version;
+
+    for (;;) {
+        begin = __atomic_load_n(&sequence, __ATOMIC_ACQUIRE);
+        if (begin & 1) {
+            continue;
+        }
+        version = __atomic_load_n(&versions[type], __ATOMIC_RELAXED);
+        *meas = values[type];
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&sequence, __ATOMIC_RELAXED) == begin) {
+            return version != 0;
+        }
+        __atomic_fetch_add(&stats.retries, 1, __ATOMIC_RELAXED);
+    }
+}
+
+uint32_t state_changed(const struct state_snapshot* snap)
+{
+    uint32_t changed = 0;
+
+    for (int type = 0; type < STATE_FIELDS; ++type) {
+        if (__atomic_load_n(&versions[type], __ATOMIC_RELAXED) != snap->versions[type]) {
+            changed |= STATE_BIT(type);
+        }
+    }
+    return changed;
+}
+
+uint32_t state_snapshot(struct state_snapshot* snap, uint32_t fields)
+{
+    uint32_t seen[STATE_FIELDS];
+    uint32_t taken;
+    uint32_t begin;
+
+    fields &= STATE_ALL;
+    // changes written after this are notified again
+    __atomic_fetch_and(&unread, ~fields, __ATOMIC_SEQ_CST);
+
+    for (;;) {
+        begin = __atomic_load_n(&sequence, __ATOMIC_ACQUIRE);
+        if (begin & 1) {
+            // a writer on the other core is inside its critical section
+            continue;
+        }
+        taken = 0;
+        for (uint32_t bits = fields; bits; bits &= bits - 1) {
+            const int type = __builtin_ctz(bits);
+            seen[type] = __atomic_load_n(&versions[type], __ATOMIC_RELAXED);
+            if (seen[type] != snap->versions[type]) {
+                snap->values[type] = values[type];
+                taken |= STATE_BIT(type);
+            }
+        }
+        // the copies are complete before the sequence is read again
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&sequence, __ATOMIC_RELAXED) == begin) {
+            break;
+        }
+        // copies of this round may be torn, versions are kept until the
+        // round is consistent so the fields are copied again
+        __atomic_fetch_add(&stats.retries, 1, __ATOMIC_RELAXED);
+    }
+
+    for (uint32_t bits = taken; bits; bits &= bits - 1) {
+        const int type = __builtin_ctz(bits);
+        snap->versions[type] = seen[type];
+    }
+    return taken;
+}
+
+void state_stats(struct state_stats* out)
+{
+    portENTER_CRITICAL(&lock);
+    *out = stats;
+    portEXIT_CRITICAL(&lock);
+    out->retries = __atomic_load_n(&stats.retries, __ATOMIC_RELAXED);
+}
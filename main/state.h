@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: MIT
+// Home state store: the current value of every measurement type with a
+// version counter per field.
+//
+// Writers from any task or core are serialized by a spinlock and bump a
+// sequence counter around every write. Readers never lock: they copy the
+// fields and retry if the sequence counter moved meanwhile (seqlock).
+
+#pragma once
+
+#include "display.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Number of fields, one per measurement type
+#define STATE_FIELDS (AVGPRICE + 1)
+
+// Field bit of a measurement type
+#define STATE_BIT(type) (1u << (type))
+
+// All fields
+#define STATE_ALL ((1u << STATE_FIELDS) - 1)
+
+/**
+ * Copy of the store kept by a reader. Version 0 is a field never written.
+ */
+struct state_snapshot {
+    uint32_t versions[STATE_FIELDS];
+    struct measurement values[STATE_FIELDS];
+};
+
+/**
+ * Store statistics.
+ */
+struct state_stats {
+    uint32_t writes;
+    uint32_t unchanged; // writes of the current value, version kept
+    uint32_t replaced;  // changed again before a reader took the change
+    uint32_t retries;   // snapshots repeated after a concurrent write
+};
+
+/**
+ * Initialize store, all fields unwritten and no reader. Called before any
+ * task uses the store.
+ */
+void state_init(void);
+
+/**
+ * Set task notified when a field changes. The reader is notified at once
+ * if fields changed before it was set.
+ * @param reader task, NULL for none
+ */
+void state_set_reader(TaskHandle_t reader);
+
+/**
+ * Write measurement into the field of its type. The version is bumped and
+ * the reader notified only if the value differs from the stored one; the
+ * reader is notified once per field until it takes the change.
+ * @param meas measurement
+ * @return true if a change not yet taken was replaced
+ */
+bool state_set(const struct measurement* meas);
+
+/**
+ * Start updating a field in place, for values combined from several
+ * sources. Runs in a critical section until state_write_end: no blocking
+ * calls in between.
+ * @param type field to update
+ * @return stored value
+ */
+struct measurement* state_write_begin(enum meastype type);
+
+/**
+ * Finish updating a field in place.
+ * @param type field given to state_write_begin
+ * @param changed true to bump the version and notify the reader
+ */
+void state_write_end(enum meastype type, bool changed);
+
+/**
+ * Wait until a field changes.
+ * @param timeout max ticks to wait
+ * @return false on timeout
+ */
+bool state_wait(TickType_t timeout);
+
+/**
+ * Get consistent copy of one field for tasks other than the reader, the
+ * change is not taken. Never blocks.
+ * @param type field to copy
+ * @param meas output value, zero if the field was never written
+ * @return false if the field was never written
+ */
+bool state_get(enum meastype type, struct measurement* meas);
+
+/**
+ * Get fields changed since a snapshot, without copying them.
+ * @param snap reader's snapshot
+ * @return bitmap of the fields, bit n is measurement type n
+ */
+uint32_t state_changed(const struct state_snapshot* snap);
+
+/**
+ * Update snapshot with a consistent copy of the changed fields. Never
+ * blocks, repeated while a write is in progress.
+ * @param snap reader's snapshot, updated in place
+ * @param fields bitmap of the fields to update, others keep their version
+ *        and stay changed
+ * @return bitmap of the updated fields
+ */
+uint32_t state_snapshot(struct state_snapshot* snap, uint32_t fields);
+
+/**
+ * Get store statistics.
+ * @param stats output statistics
+ */
+void state_stats(struct state_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
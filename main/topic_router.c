@@ -0,0 +1,195 @@
+// SPDX-License-Identifier: MIT
+// MQTT topic router: topic filters compiled into a hashed trie.
+
+#include "topic_router.h"
+
+#include <string.h>
+
+// Index of the root node
+#define ROOT 0
+
+static uint32_t edge_hash(uint16_t parent, const char* level, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    hash = (hash ^ (parent & 0xff)) * 16777619u;
+    hash = (hash ^ (parent >> 8)) * 16777619u;
+    for (size_t i = 0; i < length; ++i) {
+        hash = (hash ^ (uint8_t)level[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Find hash table slot of an edge.
+ * @return slot of the edge, or the free slot where it belongs
+ */
+static size_t find_slot(const struct topic_router* router, uint16_t parent,
+                        const char* level, size_t length)
+{
+    size_t slot = edge_hash(parent, level, length) & (TOPIC_ROUTER_EDGES - 1);
+    while (true) {
+        const struct topic_edge* edge = &router->edges[slot];
+        if (!edge->child ||
+            (edge->parent == parent && edge->length == length &&
+             !memcmp(&router->text[edge->offset], level, length))) {
+            return slot;
+        }
+        slot = (slot + 1) & (TOPIC_ROUTER_EDGES - 1);
+    }
+}
+
+static int new_node(struct topic_router* router)
+{
+    if (router->num_nodes == TOPIC_ROUTER_NODES) {
+        return -1;
+    }
+    struct topic_node* node = &router->nodes[router->num_nodes];
+    node->route = TOPIC_ROUTE_NONE;
+    node->any = TOPIC_ROUTE_NONE;
+    node->single = 0;
+    return router->num_nodes++;
+}
+
+void topic_router_init(struct topic_router* router)
+{
+    memset(router->edges, 0, sizeof(router->edges));
+    router->num_nodes = 0;
+    router->text_used = 0;
+    new_node(router);
+}
+
+bool topic_router_add(struct topic_router* router, const char* filter,
+                      int route)
+{
+    uint16_t node = ROOT;
+    const char* level = filter;
+
+    if (route < 0 || route > INT16_MAX) {
+        return false;
+    }
+
+    while (true) {
+        const char* slash = strchr(level, '/');
+        const size_t length = slash ? (size_t)(slash - level) : strlen(level);
+
+        if (length == 1 && *level == '#') {
+            if (slash) {
+                return false;
+            }
+            router->nodes[node].any = route;
+            return true;
+        }
+
+        if (length == 1 && *level == '+') {
+            if (!router->nodes[node].single) {
+                const int child = new_node(router);
+                if (child < 0) {
+                    return false;
+                }
+                router->nodes[node].single = child;
+            }
+            node = router->nodes[node].single;
+        } else {
+            const size_t slot = find_slot(router, node, level, length);
+            struct topic_edge* edge = &router->edges[slot];
+            if (!edge->child) {
+                // keep the table at most half full
+                if (router->num_nodes >= TOPIC_ROUTER_EDGES / 2 ||
+                    router->text_used + length > TOPIC_ROUTER_TEXT) {
+                    return false;
+                }
+                const int child = new_node(router);
+                if (child < 0) {
+                    return false;
+                }
+                memcpy(&router->text[router->text_used], level, length);
+                edge->parent = node;
+                edge->child = child;
+                edge->offset = router->text_used;
+                edge->length = length;
+                router->text_used += length;
+            }
+            node = edge->child;
+        }
+
+        if (!slash) {
+            router->nodes[node].route = route;
+            return true;
+        }
+        level = slash + 1;
+    }
+}
+
+/**
+ * Match remaining topic levels below a node.
+ * @param router router instance
+ * @param node current node
+ * @param level start of the next level, NULL if the topic has no more levels
+ * @param end end of the topic
+ * @return route id, TOPIC_ROUTE_NONE if no filter matches
+ */
+static int match_node(const struct topic_router* router, uint16_t node,
+                      const char* level, const char* end)
+{
+    const struct topic_node* n = &router->nodes[node];
+
+    if (!level) {
+        return n->route != TOPIC_ROUTE_NONE ? n->route : n->any;
+    }
+
+    const char* slash = memchr(level, '/', end - level);
+    const char* next = slash ? slash + 1 : NULL;
+    const size_t length = (slash ? slash : end) - level;
+
+    const size_t slot = find_slot(router, node, level, length);
+    if (router->edges[slot].child) {
+        const int route =
+            match_node(router, router->edges[slot].child, next, end);
+        if (route != TOPIC_ROUTE_NONE) {
+            return route;
+        }
+    }
+    if (n->single) {
+        const int route = match_node(router, n->single, next, end);
+        if (route != TOPIC_ROUTE_NONE) {
+            return route;
+        }
+    }
+    return n->any;
+}
+
+int topic_router_match(const struct topic_router* router, const char* topic,
+                       size_t length)
+{
+    return match_node(router, ROOT, topic, topic + length);
+}
+
+bool topic_filter_covers(const char* filter, const char* other)
+{
+    while (true) {
+        const char* slash = strchr(filter, '/');
+        const size_t length = slash ? (size_t)(slash - filter) : strlen(filter);
+        const char* other_slash = strchr(other, '/');
+        const size_t other_length =
+            other_slash ? (size_t)(other_slash - other) : strlen(other);
+
+        if (length == 1 && *filter == '#') {
+            return true;
+        }
+        const bool single = length == 1 && *filter == '+';
+        const bool other_wild =
+            other_length == 1 && (*other == '+' || *other == '#');
+        if (single ? other_length == 1 && *other == '#'
+                   : other_wild || length != other_length ||
+                       memcmp(filter, other, length)) {
+            return false;
+        }
+        if (!slash || !other_slash) {
+            // "a/#" also matches the parent level "a"
+            return !slash == !other_slash ||
+                (!other_slash && !strcmp(slash + 1, "#"));
+        }
+        filter = slash + 1;
+        other = other_slash + 1;
+    }
+}
@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: MIT
+// MQTT topic router: topic filters compiled into a hashed trie.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Max number of trie nodes (topic levels of all filters)
+#ifndef TOPIC_ROUTER_NODES
+#define TOPIC_ROUTER_NODES 256
+#endif
+
+// Size of the edge hash table, power of 2 above TOPIC_ROUTER_NODES
+#ifndef TOPIC_ROUTER_EDGES
+#define TOPIC_ROUTER_EDGES 512
+#endif
+
+// Size of the level name storage in bytes
+#ifndef TOPIC_ROUTER_TEXT
+#define TOPIC_ROUTER_TEXT 4096
+#endif
+
+// Returned by topic_router_match if no filter matches
+#define TOPIC_ROUTE_NONE (-1)
+
+// Trie node: one topic level of a filter
+struct topic_node {
+    int16_t route;    // route of the filter ending here
+    int16_t any;      // route of the '#' filter below, TOPIC_ROUTE_NONE if none
+    uint16_t single;  // child node of '+', 0 if none
+};
+
+// Trie edge: named child of a node, stored in a hash table
+struct topic_edge {
+    uint16_t parent;
+    uint16_t child; // 0 if the slot is free
+    uint16_t offset; // level name in the text storage
+    uint16_t length;
+};
+
+/**
+ * Topic filters compiled into a trie. Named children of all nodes are kept
+ * in one open addressing hash table, so matching costs one lookup per topic
+ * level regardless of the number of filters.
+ */
+struct topic_router {
+    struct topic_node nodes[TOPIC_ROUTER_NODES];
+    struct topic_edge edges[TOPIC_ROUTER_EDGES];
+    char text[TOPIC_ROUTER_TEXT];
+    size_t num_nodes;
+    size_t text_used;
+};
+
+/**
+ * Initialize empty router.
+ * @param router router to initialize
+ */
+void topic_router_init(struct topic_router* router);
+
+/**
+ * Add topic filter. Filters use MQTT wildcards: '+' matches one level,
+ * '#' matches any number of levels and must be the last one.
+ * @param router router instance
+ * @param filter topic filter
+ * @param route route id returned on match, non-negative
+ * @return false if the filter is invalid or the router is full
+ */
+bool topic_router_add(struct topic_router* router, const char* filter,
+                      int route);
+
+/**
+ * Find route of a topic. Exact levels take precedence over '+', and '+'
+ * over '#'.
+ * @param router router instance
+ * @param topic topic name, does not need to be NUL-terminated
+ * @param length topic length
+ * @return route id, TOPIC_ROUTE_NONE if no filter matches
+ */
+int topic_router_match(const struct topic_router* router, const char* topic,
+                       size_t length);
+
+/**
+ * Check if a topic filter matches every topic another filter matches.
+ * @param filter covering filter
+ * @param other covered filter
+ * @return true if subscribing to other in addition to filter is redundant
+ */
+bool topic_filter_covers(const char* filter, const char* other);
+
+#ifdef __cplusplus
+}
+#endif
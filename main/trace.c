@@ -0,0 +1,271 @@
+// SPDX-License-Identifier: MIT
+// Latency tracing of measurements from the MQTT data event to the panel.
+
+#include "trace.h"
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#define SUB_BUCKETS (1u << TRACE_SUB_BITS)
+
+static const char* const stage_names[TRACE_STAGES] = {
+    "parse", "queue", "wait", "render", "draw",
+};
+
+static const char* const type_names[TRACE_TYPES] = {
+    "comm", "temperature", "level", "carheater", "oilburner", "stockheat",
+    "solheat", "door", "flood", "time", "price", "avgprice",
+};
+
+static struct trace_histogram stages[TRACE_STAGES];
+static struct trace_histogram types[TRACE_TYPES];
+static struct trace_queue queue;
+
+// Clear requested, applied by the render task
+static bool reset_pending;
+
+/**
+ * Get bucket of a latency: values below SUB_BUCKETS have a bucket each,
+ * larger values are split by the bits below the most significant one.
+ */
+static unsigned bucket_of(uint64_t us)
+{
+    if (us < SUB_BUCKETS) {
+        return (unsigned)us;
+    }
+    const unsigned msb = 63 - __builtin_clzll(us);
+    if (msb >= TRACE_RANGE_BITS) {
+        return TRACE_BUCKETS - 1;
+    }
+    const unsigned shift = msb - TRACE_SUB_BITS;
+    return (shift + 1) << TRACE_SUB_BITS |
+        ((unsigned)(us >> shift) & (SUB_BUCKETS - 1));
+}
+
+/**
+ * Get the largest latency of a bucket.
+ */
+static uint32_t bucket_max(unsigned bucket)
+{
+    const unsigned group = bucket >> TRACE_SUB_BITS;
+    if (!group) {
+        return bucket;
+    }
+    const unsigned base = SUB_BUCKETS | (bucket & (SUB_BUCKETS - 1));
+    return ((base + 1) << (group - 1)) - 1;
+}
+
+static void add(struct trace_histogram* hist, int64_t from, int64_t to)
+{
+    if (!from || !to) {
+        return;
+    }
+    const uint64_t us = to > from ? (uint64_t)(to - from) : 0;
+    ++hist->count;
+    hist->total_us += us;
+    if (us > hist->max_us) {
+        hist->max_us = us > UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+    }
+    ++hist->buckets[bucket_of(us)];
+}
+
+static void apply_reset(void)
+{
+    if (__atomic_exchange_n(&reset_pending, false, __ATOMIC_ACQUIRE)) {
+        memset(stages, 0, sizeof(stages));
+        memset(types, 0, sizeof(types));
+        queue.batches = 0;
+        queue.taken = 0;
+        queue.depth_max = 0;
+    }
+}
+
+void trace_record(const struct measurement* meas)
+{
+    apply_reset();
+    add(&stages[TRACE_PARSE], meas->received_us, meas->parsed_us);
+    add(&stages[TRACE_QUEUE], meas->parsed_us, meas->queued_us);
+    add(&stages[TRACE_WAIT], meas->queued_us, meas->dequeued_us);
+    add(&stages[TRACE_RENDER], meas->dequeued_us, meas->rendered_us);
+    add(&stages[TRACE_DRAW], meas->rendered_us, meas->flushed_us);
+    if ((unsigned)meas->id < TRACE_TYPES) {
+        add(&types[meas->id], meas->received_us, meas->flushed_us);
+    }
+}
+
+void trace_batch(uint32_t depth)
+{
+    apply_reset();
+    ++queue.batches;
+    queue.taken += depth;
+    if (depth > queue.depth_max) {
+        queue.depth_max = depth;
+    }
+}
+
+void trace_full(void)
+{
+    __atomic_fetch_add(&queue.full, 1, __ATOMIC_RELAXED);
+}
+
+void trace_overwritten(void)
+{
+    __atomic_fetch_add(&queue.overwritten, 1, __ATOMIC_RELAXED);
+}
+
+void trace_reset(void)
+{
+    __atomic_store_n(&queue.full, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&queue.overwritten, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&reset_pending, true, __ATOMIC_RELEASE);
+}
+
+const struct trace_histogram* trace_stage_histogram(enum trace_stage stage)
+{
+    return &stages[stage];
+}
+
+const struct trace_histogram* trace_type_histogram(enum meastype type)
+{
+    return &types[type];
+}
+
+const struct trace_queue* trace_queue_stats(void)
+{
+    return &queue;
+}
+
+uint32_t trace_percentile(const struct trace_histogram* hist, unsigned permille)
+{
+    const uint32_t count = hist->count;
+    if (!count) {
+        return 0;
+    }
+    uint64_t rank = ((uint64_t)count * permille + 999) / 1000;
+    if (!rank) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < TRACE_BUCKETS; ++i) {
+        seen += hist->buckets[i];
+        if (seen >= rank) {
+            const uint32_t us = bucket_max(i);
+            return us < hist->max_us ? us : hist->max_us;
+        }
+    }
+    return hist->max_us;
+}
+
+static uint32_t average(const struct trace_histogram* hist)
+{
+    return hist->count ? (uint32_t)(hist->total_us / hist->count) : 0;
+}
+
+/**
+ * Append formatted text.
+ * @return false if the output buffer is full
+ */
+static bool append(char* out, size_t size, size_t* length, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    const int res = vsnprintf(out + *length, size - *length, format, args);
+    va_end(args);
+    if (res < 0 || (size_t)res >= size - *length) {
+        return false;
+    }
+    *length += res;
+    return true;
+}
+
+static bool append_histograms(char* out, size_t size, size_t* length,
+                              const char* key,
+                              const struct trace_histogram* hists,
+                              const char* const* names, size_t num)
+{
+    const char* sep = "";
+    if (!append(out, size, length, ",\"%s\":{", key)) {
+        return false;
+    }
+    for (size_t i = 0; i < num; ++i) {
+        const struct trace_histogram* hist = &hists[i];
+        if (!hist->count) {
+            continue;
+        }
+        if (!append(out, size, length,
+                    "%s\"%s\":{\"count\":%lu,\"avg\":%lu,\"p50\":%lu,"
+                    "\"p90\":%lu,\"p99\":%lu,\"max\":%lu}",
+                    sep, names[i], (unsigned long)hist->count,
+                    (unsigned long)average(hist),
+                    (unsigned long)trace_percentile(hist, 500),
+                    (unsigned long)trace_percentile(hist, 900),
+                    (unsigned long)trace_percentile(hist, 990),
+                    (unsigned long)hist->max_us)) {
+            return false;
+        }
+        sep = ",";
+    }
+    return append(out, size, length, "}");
+}
+
+size_t trace_json(char* out, size_t size)
+{
+    size_t length = 0;
+
+    if (!size) {
+        return 0;
+    }
+    const bool ok =
+        append(out, size, &length,
+               "{\"queue\":{\"batches\":%lu,\"taken\":%lu,\"depth_max\":%lu,"
+               "\"full\":%lu,\"overwritten\":%lu}",
+               (unsigned long)queue.batches, (unsigned long)queue.taken,
+               (unsigned long)queue.depth_max,
+               (unsigned long)__atomic_load_n(&queue.full, __ATOMIC_RELAXED),
+               (unsigned long)__atomic_load_n(&queue.overwritten,
+                                              __ATOMIC_RELAXED)) &&
+        append_histograms(out, size, &length, "stages", stages, stage_names,
+                          TRACE_STAGES) &&
+        append_histograms(out, size, &length, "latency", types, type_names,
+                          TRACE_TYPES) &&
+        append(out, size, &length, "}");
+    if (!ok) {
+        out[0] = 0;
+        return 0;
+    }
+    return length;
+}
+
+static void print_histograms(const char* title,
+                             const struct trace_histogram* hists,
+                             const char* const* names, size_t num)
+{
+    printf("%-12s %8s %8s %8s %8s %8s %8s\n", title, "count", "avg us",
+           "p50", "p90", "p99", "max");
+    for (size_t i = 0; i < num; ++i) {
+        const struct trace_histogram* hist = &hists[i];
+        if (!hist->count) {
+            continue;
+        }
+        printf("%-12s %8lu %8lu %8lu %8lu %8lu %8lu\n", names[i],
+               (unsigned long)hist->count, (unsigned long)average(hist),
+               (unsigned long)trace_percentile(hist, 500),
+               (unsigned long)trace_percentile(hist, 900),
+               (unsigned long)trace_percentile(hist, 990),
+               (unsigned long)hist->max_us);
+    }
+}
+
+void trace_print(void)
+{
+    print_histograms("stage", stages, stage_names, TRACE_STAGES);
+    print_histograms("received to", types, type_names, TRACE_TYPES);
+    printf("frames: %lu, %lu measurements, %lu max per frame, "
+           "%lu dropped, %lu overwritten\n",
+           (unsigned long)queue.batches, (unsigned long)queue.taken,
+           (unsigned long)queue.depth_max,
+           (unsigned long)__atomic_load_n(&queue.full, __ATOMIC_RELAXED),
+           (unsigned long)__atomic_load_n(&queue.overwritten, __ATOMIC_RELAXED));
+}
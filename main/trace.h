@@ -0,0 +1,138 @@
+// SPDX-License-Identifier: MIT
+// Latency tracing of measurements from the MQTT data event to the panel.
+//
+// Latencies are kept in log bucket histograms: 2^TRACE_SUB_BITS buckets per
+// power of two, the bucket width is at most 1/2^TRACE_SUB_BITS of its
+// value. Histograms are written by the render task only and read in place
+// without locking, a report may mix counts of two frames.
+
+#pragma once
+
+#include "display.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Number of measurement types
+#define TRACE_TYPES (AVGPRICE + 1)
+
+// Sub-buckets per power of two, as a shift
+#define TRACE_SUB_BITS 2
+
+// Range of the buckets, larger latencies are counted in the last bucket
+#define TRACE_RANGE_BITS 26
+
+#define TRACE_BUCKETS ((TRACE_RANGE_BITS - TRACE_SUB_BITS + 1) << TRACE_SUB_BITS)
+
+/**
+ * Stage between two consecutive measurement times.
+ */
+enum trace_stage {
+    TRACE_PARSE,  // received to parsed
+    TRACE_QUEUE,  // parsed to queued
+    TRACE_WAIT,   // queued to dequeued
+    TRACE_RENDER, // dequeued to drawing started
+    TRACE_DRAW,   // drawing started to flushed
+    TRACE_STAGES
+};
+
+/**
+ * Latency histogram.
+ */
+struct trace_histogram {
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t total_us;
+    uint32_t buckets[TRACE_BUCKETS];
+};
+
+/**
+ * Render input counters.
+ */
+struct trace_queue {
+    uint32_t batches;     // frames rendered
+    uint32_t taken;       // measurements rendered
+    uint32_t depth_max;   // most measurements taken for one frame
+    uint32_t full;        // dropped on a full queue or ring
+    uint32_t overwritten; // replaced in the mailbox before rendered
+};
+
+/**
+ * Record the times of a rendered measurement, called by the render task.
+ * Stages with a zero time at either end are skipped; the received to
+ * flushed latency is recorded per measurement type.
+ * @param meas measurement with its times
+ */
+void trace_record(const struct measurement* meas);
+
+/**
+ * Record the measurements taken for one frame, called by the render task.
+ * @param depth number of measurements
+ */
+void trace_batch(uint32_t depth);
+
+/**
+ * Count measurement dropped by the render input, called by any task.
+ */
+void trace_full(void);
+
+/**
+ * Count measurement replaced before it was rendered, called by any task.
+ */
+void trace_overwritten(void);
+
+/**
+ * Clear histograms and counters. The histograms are cleared by the render
+ * task when it records the next frame.
+ */
+void trace_reset(void);
+
+/**
+ * Get histogram of a stage.
+ * @param stage stage
+ * @return histogram
+ */
+const struct trace_histogram* trace_stage_histogram(enum trace_stage stage);
+
+/**
+ * Get received to flushed histogram of a measurement type.
+ * @param type measurement type
+ * @return histogram
+ */
+const struct trace_histogram* trace_type_histogram(enum meastype type);
+
+/**
+ * Get render input counters.
+ * @return counters
+ */
+const struct trace_queue* trace_queue_stats(void);
+
+/**
+ * Get latency percentile.
+ * @param hist histogram
+ * @param permille percentile in 1/1000
+ * @return upper bound of the bucket of the percentile, in us
+ */
+uint32_t trace_percentile(const struct trace_histogram* hist, unsigned permille);
+
+/**
+ * Format histograms and counters as JSON, histograms without samples are
+ * left out.
+ * @param out output buffer
+ * @param size size of the output buffer
+ * @return length of the JSON, 0 if it does not fit
+ */
+size_t trace_json(char* out, size_t size);
+
+/**
+ * Print histograms and counters as a table to stdout.
+ */
+void trace_print(void);
+
+#ifdef __cplusplus
+}
+#endif